@@ -17,11 +17,14 @@ namespace popular
     /**
      * A generic abstract class for the definition of the common behaviour of
      * Socially Diverse k-Nearest Neighbours query algorithms.
+     * An algorithm refers to a corpus that must outlive it and is constructed once
+     * to answer any number of queries. The corpus may grow between queries (see
+     * CorpusUpdater); state derived from it must be refreshed when corpus.version
+     * changes.
      */
      class Algorithm
      {
      public:
-         Algorithm() {}
          virtual ~Algorithm() {}
 
          Algorithm(Corpus const& corpus): corpus_(corpus) {}
@@ -40,6 +43,11 @@ namespace popular
           virtual void query(uint32_t /*k*/, Point const& /*q*/, float const& /*a*/,
                   ResultSet &/*results*/, double &/*z_from_lp*/, uint32_t &/*prunes*/, uint32_t &/*reheaps*/) {}
 
+          /**
+           * Adds the algorithm-specific counters of the last query to the stats (untimed)
+           */
+          virtual void fill_stats(Stats &/*stats*/) const {}
+
           /**
            * Retrieve results method (untimed)
            */
@@ -47,7 +55,7 @@ namespace popular
                   ResultSet &/*results*/, double &/*z_from_lp*/) {}
 
      protected:
-         Corpus corpus_;
+         Corpus const& corpus_;
      private:
      };
 
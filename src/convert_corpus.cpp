@@ -0,0 +1,122 @@
+/**
+ * convert_corpus.cpp
+ * Converts a tab-separated check-in file into a memory-mappable corpus snapshot and,
+ * optionally, writes the R-tree index of the corpus as a page file for out-of-core queries.
+ */
+
+#include <iostream>
+#include <algorithm> // std::find
+#include <boost/program_options.hpp> // for handling input arguments
+
+#include "util/commons.hpp"
+#include "util/inputReader.hpp"
+#include "util/corpusSnapshot.hpp"
+#include "rtree/rtree.hpp"
+
+namespace po = boost::program_options;
+
+const char* ARG_HELP = "help";
+const char* ARG_INPUT = "input";
+const char* ARG_OUTPUT = "output";
+const char* ARG_INDEX_PAGES = "index-pages";
+const char* ARG_RTREE_BUILD = "rtree-build";
+const char* ARG_FANOUT = "fanout";
+
+int main( int argc, char** argv ) {
+
+    using namespace popular;
+
+    try {
+        po::options_description desc("Allowed options");
+        desc.add_options()
+                (ARG_HELP, "produce help message")
+                (ARG_INPUT, po::value< std::string >(), "tab-separated input file (or an existing snapshot)")
+                (ARG_OUTPUT, po::value< std::string >(), "snapshot file to write")
+                (ARG_INDEX_PAGES, po::value< std::string >(), "R-tree page file to write, for diversify_pois --index-pages")
+                (ARG_RTREE_BUILD, po::value< std::string >()->default_value("insert"),
+                 "how the R-tree of the page file is built; choices are: insert str rstar social (experimental)")
+                (ARG_FANOUT, po::value< uint32_t >()->default_value(Constants::RTREEMAXNODES),
+                 "number of branches per node of the R-tree of the page file; choices are: 4 8 16 32 64");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc, po::command_line_style::unix_style ^ po::command_line_style::allow_short), vm);
+        po::notify(vm);
+
+        if (vm.count(ARG_HELP) || !vm.count(ARG_INPUT) || !vm.count(ARG_OUTPUT))
+        {
+            std::cout << desc << std::endl;
+            return vm.count(ARG_HELP) ? 0 : 1;
+        }
+
+        std::string input_file = vm[ARG_INPUT].as< std::string >();
+        std::string const output_file = vm[ARG_OUTPUT].as< std::string >();
+
+        std::string const build_name = vm[ARG_RTREE_BUILD].as< std::string >();
+        Index_Build build;
+        if (build_name.compare("insert") == 0)
+        {
+            build = Index_Build::Insert;
+        }
+        else if (build_name.compare("str") == 0)
+        {
+            build = Index_Build::STR;
+        }
+        else if (build_name.compare("social") == 0)
+        {
+            build = Index_Build::Social;
+        }
+        else if (build_name.compare("rstar") == 0)
+        {
+            build = Index_Build::RStar;
+        }
+        else
+        {
+            std::cerr << "R-tree build " << build_name << " unknown." << std::endl;
+            std::cout << desc << std::endl;
+            return 1;
+        }
+        uint32_t const fanout = vm[ARG_FANOUT].as< uint32_t >();
+        if (std::find(std::begin(Constants::RTREE_FANOUTS), std::end(Constants::RTREE_FANOUTS), fanout)
+            == std::end(Constants::RTREE_FANOUTS))
+        {
+            std::cerr << "R-tree fanout " << fanout << " unsupported." << std::endl;
+            std::cout << desc << std::endl;
+            return 1;
+        }
+
+        Corpus corpus;
+        InputReader ir;
+        if (ir.readFile(input_file, corpus) == 1)
+        {
+            return 1;
+        }
+        std::cout << "Read " << ir.bytes_read() / (1024.0 * 1024.0) << " MB in " << ir.seconds()
+                  << " s (" << ir.megabytes_per_second() << " MB/s): " << corpus.num_places() << " POIs, "
+                  << corpus.num_users() << " users, " << corpus.num_checkins << " check-ins" << std::endl;
+
+        if (CorpusSnapshot().write(output_file, corpus) == 1)
+        {
+            return 1;
+        }
+        std::cout << "Wrote snapshot version " << Constants::SNAPSHOT_VERSION << " to " << output_file << std::endl;
+
+        if (vm.count(ARG_INDEX_PAGES))
+        {
+            std::string const page_file = vm[ARG_INDEX_PAGES].as< std::string >();
+            std::unique_ptr< Index > index = Index::create(fanout);
+            index->buildIndex(corpus, build);
+            if (index->writePages(page_file, corpus) == 1)
+            {
+                return 1;
+            }
+            std::cout << "Wrote R-tree page file version " << Constants::PAGED_INDEX_VERSION << " to " << page_file << std::endl;
+        }
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
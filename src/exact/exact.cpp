@@ -8,13 +8,14 @@
 #include "../util/constants.hpp"
 
 #include <algorithm> // for_each, prev_permutation
+#include <numeric> // std::iota
 
 namespace popular
 {
     namespace
     {
         // https://stackoverflow.com/a/9430993
-        void create_combinations(uint32_t k, std::vector< Point > const& points, Corpus const& corpus, float const& a,
+        void create_combinations(uint32_t k, std::vector< PoiId > const& points, Corpus const& corpus, float const& a,
                 Point const& q, ResultSet &results, double &z_from_lp)
         {
             uint32_t n = points.size();
@@ -28,11 +29,12 @@ namespace popular
             std::fill(v.begin(), v.begin() + k, true);
 
             do {
-                PointsSet one_comb;
+                PoiSet one_comb;
+                one_comb.reserve(k);
 
                 for (uint32_t i = 0; i < n; ++i)
                 {
-                    if (v[i]) { one_comb.insert( points[i] ); }
+                    if (v[i]) { one_comb.push_back( points[i] ); }
                 }
 
                 double score = scoring(q, one_comb);
@@ -51,8 +53,8 @@ namespace popular
     void Exact::query(uint32_t k, Point const& q, float const& a, ResultSet &results, double &z_from_lp,
             uint32_t &prunes, uint32_t &reheaps)
     {
-        std::vector< Point > points;
-        points.assign(corpus_.places.cbegin(), corpus_.places.cend());
+        std::vector< PoiId > points(corpus_.num_places());
+        std::iota(points.begin(), points.end(), 0);
 
         create_combinations(k, points, corpus_, a, q, results, z_from_lp);
         prunes = 0;
@@ -15,7 +15,6 @@ namespace popular
     class Exact : public Algorithm
     {
     public:
-        Exact() {} /**< Empty constructor */
         ~Exact() {} /**< Empty destructor */
 
         Exact(Corpus const& corpus): Algorithm(corpus) {}
@@ -8,6 +8,8 @@
 #include "../util/constants.hpp"
 #include "greedy_scores.hpp"
 
+#include <numeric> // std::iota
+
 namespace // anonymous
 {
     using namespace popular;
@@ -18,8 +20,8 @@ namespace // anonymous
      * @param k : the number of points in the result
      * @param res : the result
      */
-    std::pair< Point, double > greedy_deciding  ( Point const q
-                                                , PointsSet const& corpus_pois
+    std::pair< PoiId, double > greedy_deciding  ( Point const q
+                                                , PoiSet const& corpus_pois
                                                 , main_scoring const& scoring
                                                 , IntermediateRes const& intermediateRes )
     {
@@ -33,20 +35,22 @@ namespace popular
     void Greedy< variant >::query(uint32_t k, Point const& q, float const& a, ResultSet &results, double &z_from_lp,
             uint32_t &prunes, uint32_t &reheaps)
     {
-        PointsSet corpus_pois(corpus_.places.begin(), corpus_.places.end());
+        PoiSet corpus_pois(corpus_.num_places());
+        std::iota(corpus_pois.begin(), corpus_pois.end(), 0);
         main_scoring scoring{ user_similarity{ corpus_ }, a, k};
 
-        IntermediateRes intermediateRes { std::vector< UserId >(), 0.0 };
+        IntermediateRes intermediateRes { Coverage( corpus_.num_users() ), 0.0 };
 
         for( auto i = 0u; i < k; ++i )
         {
             if( corpus_pois.empty() ) { continue; }
 
             auto const [ chosen_point, score ] = greedy_deciding( q, corpus_pois, scoring, intermediateRes );
-            results.first.insert(chosen_point);
+            results.first.push_back(chosen_point);
 
-            addIntermediate(intermediateRes, q, chosen_point, corpus_.max_distance, corpus_.checkins.at(chosen_point));
-            corpus_pois.erase(chosen_point);
+            addIntermediate(intermediateRes, q, corpus_.point(chosen_point), corpus_.max_distance,
+                            corpus_.checkins(chosen_point));
+            corpus_pois.erase(std::find(corpus_pois.begin(), corpus_pois.end(), chosen_point));
         }
 
         results.second = scoring(q, results.first);
@@ -24,7 +24,6 @@ namespace popular
     class Greedy : public Algorithm
     {
     public:
-        Greedy() {} /**< Empty constructor */
         ~Greedy() {} /**< Empty destructor */
 
         Greedy(Corpus const& corpus): Algorithm(corpus) {}
@@ -13,12 +13,12 @@ namespace popular
     /**
      * Score each point of the candidates_set together with the points of the chosen_set
      */
-     std::pair< Point, double > score_with_function ( Point const q
-                                                    , PointsSet const& candidates
+     std::pair< PoiId, double > score_with_function ( Point const q
+                                                    , PoiSet const& candidates
                                                     , main_scoring const& scoring
                                                     , IntermediateRes const& intermediateRes )
     {
-        Point best_point{ 0, 0 };
+        PoiId best_point{ 0 };
         auto max_score = std::numeric_limits< double >::max() * -1.0;
 
         for( auto const point : candidates )
@@ -10,15 +10,15 @@
 namespace { //anonymous
 
     /**
-     * Converts a PriorityQueue into a PointsSet
+     * Converts a PriorityQueue into a PoiSet
      */
-    popular::PointsSet PQ_to_PS( popular::PriorityQueue && candidates )
+    popular::PoiSet PQ_to_PS( popular::PriorityQueue && candidates )
     {
-        popular::PointsSet res;
+        popular::PoiSet res;
 
         while ( ! candidates.isEmpty() )
         {
-            res.insert( candidates.return_best() );
+            res.push_back( candidates.return_best() );
         }
 
         return res;
@@ -33,7 +33,7 @@ namespace popular
             double &z_from_lp, uint32_t &prunes, uint32_t &reheaps)
     {
         z_from_lp = prunes = reheaps = 0;
-        assert( "Dataset contains at least k possible answers" && corpus_.places.size() >= k );
+        assert( "Dataset contains at least k possible answers" && corpus_.num_places() >= k );
         
         results.first = PQ_to_PS( scoring( PriorityQueue( k )
                                 , q
@@ -51,7 +51,7 @@ namespace popular
                                                , Point const q
                                                , float const alpha ) const
     {
-        for( Point const p : corpus_.places )
+        for( PoiId p = 0; p < corpus_.num_places(); ++p )
         {
             candidates.add_to_queue( p
                                    , score( p, q, alpha ) );
@@ -62,19 +62,19 @@ namespace popular
     }
 
     template <>
-    double Heuristic< Heuristic_Variant::Naive_user >::score( Point const p, Point const, float const ) const
+    double Heuristic< Heuristic_Variant::Naive_user >::score( PoiId const p, Point const, float const ) const
     {
         return user_sim( p );
     }
 
     template <>
-    double Heuristic< Heuristic_Variant::Naive_dist >::score( Point const p, Point const q, float const ) const
+    double Heuristic< Heuristic_Variant::Naive_dist >::score( PoiId const p, Point const q, float const ) const
     {
         return spatial_sim( p, q );
     }
 
     template <>
-    double Heuristic< Heuristic_Variant::Naive >::score( Point const p, Point const q, float const alpha ) const
+    double Heuristic< Heuristic_Variant::Naive >::score( PoiId const p, Point const q, float const alpha ) const
     {
         return alpha * spatial_sim( p, q ) + ( 1.0 - alpha ) * user_sim( p );
     }
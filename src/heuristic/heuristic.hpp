@@ -26,7 +26,6 @@ namespace popular
     class Heuristic : public Algorithm
     {
     public:
-        Heuristic() {} /**< Empty constructor */
         ~Heuristic() {} /**< Empty destructor */
 
         Heuristic(Corpus const& corpus): Algorithm(corpus) {}
@@ -37,16 +36,16 @@ namespace popular
     private:
         PriorityQueue scoring( PriorityQueue && pq, Point const q, float const alpha ) const;
 
-        double score( Point const p, Point const q, float const alpha ) const;
+        double score( PoiId const p, Point const q, float const alpha ) const;
 
-        double user_sim( Point const p ) const
+        double user_sim( PoiId const p ) const
         {
-            return corpus_.checkins.at( p ).size() / static_cast< double >( corpus_.users.size() );
+            return corpus_.checkins( p ).size() / static_cast< double >( corpus_.num_users() );
         }
 
-        double spatial_sim( Point const p, Point const q ) const
+        double spatial_sim( PoiId const p, Point const q ) const
         {
-            return 1.0 - distance( p, q ) / corpus_.max_distance;
+            return 1.0 - distance( corpus_.point( p ), q ) / corpus_.max_distance;
         }
     };
 
@@ -7,48 +7,57 @@ extern "C" {
 #include "../util/topkPriorityQueue.hpp"
 
 #include <algorithm> // for_each, prev_permutation
+#include <numeric> // std::iota
 #include <glpk.h>
 
 namespace popular
 {
     namespace
     {
-        void populate_checkins(double *checks,
-                std::unordered_map< Point, std::vector< UserId >, boost::hash< Point > > const& checkins,
-                               std::vector< UserId > users, std::vector< Point > points)
+        void populate_checkins(double *checks, Corpus const& corpus,
+                               std::vector< UserId > const& users, std::vector< PoiId > const& points)
         {
+            std::fill(checks, checks + users.size()*points.size(), 0.0);
             for(uint32_t j = 0; j < points.size(); j++)
             {
-                std::vector< UserId > poi_users = checkins.at(points[j]);
-                for(uint32_t i = 0; i < users.size(); i++)
+                for(UserId const i : corpus.checkins(points[j]))
                 {
-                    if(std::find(poi_users.begin(), poi_users.end(), users[i]) != poi_users.end())
-                    {
-                        *((checks+i*points.size()) + j) = 1.0;
-                    }
-                    else
-                    {
-                        *((checks+i*points.size()) + j) = 0.0;
-                    }
+                    *((checks+i*points.size()) + j) = 1.0;
                 }
             }
         }
     } // namespace anonymous
 
+    template < LP_Variant variant >
+    void Lp< variant >::release()
+    {
+        free(dists_);
+        free(checkins_);
+        free(ia);
+        free(ja);
+        free(ar);
+        free(xjs);
+        dists_ = checkins_ = ar = xjs = nullptr;
+        ia = ja = nullptr;
+    }
+
     template < LP_Variant variant >
     void Lp< variant >::preprocess(Point const& q, uint32_t k, float const& a)
     {
-        points.assign(corpus_.places.cbegin(), corpus_.places.cend());
+        release();
+        points.resize(corpus_.num_places());
+        std::iota(points.begin(), points.end(), 0);
         dists_ = (double *)malloc(sizeof(double)*points.size());
         for(uint32_t i = 0; i< points.size(); i++)
         {
-            dists_[i] = ( 1 - distance(q, points[i])/corpus_.max_distance ) / k;
+            dists_[i] = ( 1 - distance(q, corpus_.point(points[i]))/corpus_.max_distance ) / k;
         }
 
-        users.assign(corpus_.users.cbegin(), corpus_.users.cend());
+        users.resize(corpus_.num_users());
+        std::iota(users.begin(), users.end(), 0);
 
         checkins_ = (double *) malloc(sizeof(double)*users.size()*points.size());
-        populate_checkins(checkins_, corpus_.checkins, users, points);
+        populate_checkins(checkins_, corpus_, users, points);
 
         unsigned long long size = (users.size() + points.size()) * (users.size() + 1);
 
@@ -87,10 +96,10 @@ namespace popular
             r.add_to_queue(points[i], xjs[i]);
         }
         r.swap_queue();
-        results.first.insert(r.return_best());
+        results.first.push_back(r.return_best());
         while (results.first.size() < k && !r.isEmpty())
         {
-            results.first.insert(r.return_best());
+            results.first.push_back(r.return_best());
         }
 
         user_similarity user_sim{corpus_};
@@ -18,18 +18,13 @@ namespace popular
     class Lp : public Algorithm
     {
     public:
-        Lp() {} /**< Empty constructor */
         ~Lp() /**< Destructor */
         {
-            free(dists_);
-            free(checkins_);
-            free(ia);
-            free(ja);
-            free(ar);
-            free(xjs);
+            release();
         }
 
-        Lp(Corpus const& corpus): Algorithm(corpus) {}
+        Lp(Corpus const& corpus): Algorithm(corpus), dists_(nullptr), checkins_(nullptr), lp_(nullptr),
+                                  ia(nullptr), ja(nullptr), ar(nullptr), xjs(nullptr) {}
 
         void preprocess(Point const& q, uint32_t k, float const& a) override;
         void query(uint32_t k, Point const& q, float const& a, ResultSet &results, double &z_from_lp,
@@ -40,8 +35,9 @@ namespace popular
         void i_lp_setup(uint32_t const& k, double const& a, int *ia, int *ja, double *ar);
         void i_lp(int *ia, int *ja, double *ar) const;
         void i_lp_retrieve(double *z, double *yis) const;
+        void release(); /**< Frees the buffers of the previous query */
 
-        std::vector< Point > points;
+        std::vector< PoiId > points;
         std::vector< UserId > users;
         double *dists_;
         double *checkins_;
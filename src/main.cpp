@@ -7,9 +7,12 @@
 #include <chrono> // for timing
 #include <sys/resource.h> // for reading mem usage
 #include <fstream> // for ifstream
+#include <memory> // std::unique_ptr
+#include <algorithm> // std::find
 
 #include "util/commons.hpp"
 #include "util/inputReader.hpp"
+#include "util/corpusUpdater.hpp"
 #include "algorithm/algorithm.hpp"
 #include "greedy/greedy.hpp"
 #include "heuristic/heuristic.hpp"
@@ -18,6 +21,7 @@
 #include "ilp/lp.hpp"
 #include "ilp/lp_methods.h" // I don't understand why this is needed here
 #include "rtree/rtree.hpp"
+#include "rtree/quadIndex.hpp"
 
 namespace po = boost::program_options;
 
@@ -25,8 +29,19 @@ const char* ARG_HELP = "help";
 const char* ARG_K = "k";
 const char* ARG_Q = "query";
 const char* ARG_INPUT = "input";
+const char* ARG_APPEND = "append";
 const char* ARG_ALGORITHM = "algorithm";
 const char* ARG_A = "a";
+const char* ARG_INDEX_PAGES = "index-pages";
+const char* ARG_BUFFER_PAGES = "buffer-pages";
+const char* ARG_RTREE_BUILD = "rtree-build";
+const char* ARG_FANOUT = "fanout";
+const char* ARG_RTREE_BOUND = "rtree-bound";
+const char* ARG_RTREE_QUEUE = "rtree-queue";
+const char* ARG_SAVE_INDEX = "save-index";
+const char* ARG_LOAD_INDEX = "load-index";
+const char* ARG_INDEX_MEMORY = "index-memory";
+const char* ARG_INDEX_QUALITY = "index-quality";
 
 namespace
 {
@@ -37,6 +52,13 @@ namespace
         std::string input_file;
         std::stringstream algorithms;
         float a;
+        std::string page_file;
+        size_t buffer_pages;
+        popular::Index_Build build;
+        uint32_t fanout;
+        popular::SearchOptions search;
+        std::string save_index;
+        std::string load_index;
     };
 
     struct Rule {};
@@ -78,7 +100,7 @@ int main( int argc, char** argv ) {
 
     Parameters parameters;
     Corpus corpus;
-    Algorithm *alg;
+    std::unique_ptr< Algorithm > alg;
     Stats stats;
     OutputWriter outWriter;
 
@@ -89,10 +111,30 @@ int main( int argc, char** argv ) {
                 (ARG_K, po::value< std::uint32_t >(), "number of POIs to report")
                 (ARG_Q, po::value< std::vector< std::string > >()->multitoken(), "query point(s), multi token")
                 (ARG_INPUT, po::value< std::string >(), "set input file")
+                (ARG_APPEND, po::value< std::vector< std::string > >()->multitoken(),
+                 "tab-separated check-in batch(es) to append to the input, in order, multi token")
                 (ARG_ALGORITHM, po::value< std::string >(),
                  "choose algorithm(s), space separated; choices are:"
-                 " exact naive dist user greedy lp ilp rtree re-heap")
-                (ARG_A, po::value< float >(), "the parameter alpha");
+                 " exact naive dist user greedy lp ilp rtree re-heap quadtree")
+                (ARG_A, po::value< float >(), "the parameter alpha")
+                (ARG_INDEX_PAGES, po::value< std::string >(),
+                 "answer rtree and re-heap queries from this R-tree page file (see convert_corpus) instead of building the index in memory")
+                (ARG_BUFFER_PAGES, po::value< size_t >()->default_value(1024),
+                 "number of pages of the page file kept in memory")
+                (ARG_RTREE_BUILD, po::value< std::string >()->default_value("insert"),
+                 "how the R-tree is built; choices are: insert (one POI at a time) str (Sort-Tile-Recursive bulk loading) rstar (one POI at a time, R*-tree policy) social (as str, leaves grouped by shared users; experimental)")
+                (ARG_FANOUT, po::value< uint32_t >()->default_value(popular::Constants::RTREEMAXNODES),
+                 "number of branches per R-tree node, and of POIs per quadtree leaf; choices are: 4 8 16 32 64")
+                (ARG_RTREE_BOUND, po::value< std::string >()->default_value("union"),
+                 "how the users below an R-tree branch are bounded; choices are: union (all users below it)"
+                 " poi (capped by its largest POI) lazy (poi, bounded again when dequeued)")
+                (ARG_RTREE_QUEUE, po::value< std::string >()->default_value("binary"),
+                 "the priority queue of the R-tree search; choices are: binary (heap) dary (4-ary heap) bucket (buckets over the scores)")
+                (ARG_SAVE_INDEX, po::value< std::string >(), "save the R-tree index with its user sets to this file after building it")
+                (ARG_LOAD_INDEX, po::value< std::string >(),
+                 "load the R-tree index from this file (see --save-index) instead of building it; its fanout overrides --fanout")
+                (ARG_INDEX_MEMORY, "print the memory of the R-tree index per level after building or loading it")
+                (ARG_INDEX_QUALITY, "print the node overlap and dead space of the R-tree index per level after building or loading it");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc, po::command_line_style::unix_style ^ po::command_line_style::allow_short), vm);
@@ -112,6 +154,8 @@ int main( int argc, char** argv ) {
             {
                 return 1;
             }
+            std::cout << "\033[93mRead " << ir.bytes_read() / (1024.0 * 1024.0) << " MB in " << ir.seconds()
+                      << " s (" << ir.megabytes_per_second() << " MB/s)\033[00m" << std::endl;
             stats.input_file = parameters.input_file;
         }
         else
@@ -156,98 +200,358 @@ int main( int argc, char** argv ) {
             std::cout << desc << std::endl;
             return 0;
         }
+        if (vm.count(ARG_INDEX_PAGES))
+        {
+            parameters.page_file = vm[ARG_INDEX_PAGES].as< std::string >();
+        }
+        parameters.buffer_pages = vm[ARG_BUFFER_PAGES].as< size_t >();
+        if (vm[ARG_RTREE_BUILD].as< std::string >().compare("str") == 0)
+        {
+            parameters.build = Index_Build::STR;
+        }
+        else if (vm[ARG_RTREE_BUILD].as< std::string >().compare("social") == 0)
+        {
+            parameters.build = Index_Build::Social;
+        }
+        else if (vm[ARG_RTREE_BUILD].as< std::string >().compare("rstar") == 0)
+        {
+            parameters.build = Index_Build::RStar;
+        }
+        else if (vm[ARG_RTREE_BUILD].as< std::string >().compare("insert") == 0)
+        {
+            parameters.build = Index_Build::Insert;
+        }
+        else
+        {
+            std::cout << "R-tree build " << vm[ARG_RTREE_BUILD].as< std::string >() << " unknown." << std::endl;
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        parameters.fanout = vm[ARG_FANOUT].as< uint32_t >();
+        if (std::find(std::begin(Constants::RTREE_FANOUTS), std::end(Constants::RTREE_FANOUTS), parameters.fanout)
+            == std::end(Constants::RTREE_FANOUTS))
+        {
+            std::cout << "R-tree fanout " << parameters.fanout << " unsupported." << std::endl;
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        if (vm[ARG_RTREE_BOUND].as< std::string >().compare("union") == 0)
+        {
+            parameters.search.bound = Index_Bound::Union;
+        }
+        else if (vm[ARG_RTREE_BOUND].as< std::string >().compare("poi") == 0)
+        {
+            parameters.search.bound = Index_Bound::MaxPoi;
+        }
+        else if (vm[ARG_RTREE_BOUND].as< std::string >().compare("lazy") == 0)
+        {
+            parameters.search.bound = Index_Bound::Lazy;
+        }
+        else
+        {
+            std::cout << "R-tree bound " << vm[ARG_RTREE_BOUND].as< std::string >() << " unknown." << std::endl;
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        if (parameters.search.bound != Index_Bound::Union && vm.count(ARG_INDEX_PAGES))
+        {
+            std::cout << "R-tree bound " << vm[ARG_RTREE_BOUND].as< std::string >()
+                      << " needs the index in memory; page files only support union." << std::endl;
+            return 0;
+        }
+        if (vm[ARG_RTREE_QUEUE].as< std::string >().compare("binary") == 0)
+        {
+            parameters.search.queue = Index_Queue::Binary;
+        }
+        else if (vm[ARG_RTREE_QUEUE].as< std::string >().compare("dary") == 0)
+        {
+            parameters.search.queue = Index_Queue::Dary;
+        }
+        else if (vm[ARG_RTREE_QUEUE].as< std::string >().compare("bucket") == 0)
+        {
+            parameters.search.queue = Index_Queue::Bucket;
+        }
+        else
+        {
+            std::cout << "R-tree queue " << vm[ARG_RTREE_QUEUE].as< std::string >() << " unknown." << std::endl;
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        if (vm.count(ARG_SAVE_INDEX))
+        {
+            parameters.save_index = vm[ARG_SAVE_INDEX].as< std::string >();
+        }
+        if (vm.count(ARG_LOAD_INDEX))
+        {
+            parameters.load_index = vm[ARG_LOAD_INDEX].as< std::string >();
+        }
         if (vm.count(ARG_ALGORITHM))
         {
             parameters.algorithms.str(vm[ARG_ALGORITHM].as< std::string >());
             std::string next_algorithm;
 
-            std::cout << tag_headers << std::endl << tag_rule << std::endl;
-            while (parameters.algorithms >> next_algorithm)
+            // the R-tree of the corpus, built (or loaded) on first use and shared by all rtree and
+            // re-heap queries; nullptr if it could not be loaded or saved
+            std::shared_ptr< Index > index;
+            auto const shared_index = [ &index, &corpus, &parameters, &vm ]() -> std::shared_ptr< Index const >
             {
-                uint32_t query_index = 1;
-                std::unordered_map< std::string, std::vector< long double > > batches;
-                for (auto const& q : parameters.query_points)
+                if (parameters.page_file.empty() && !index && !parameters.load_index.empty())
                 {
-                    if (next_algorithm.compare("exact") == 0)
+                    auto const start_load = std::chrono::high_resolution_clock::now();
+                    index = Index::load(parameters.load_index, corpus);
+                    if (!index)
                     {
-                        alg = new Exact(corpus);
-                        stats.algorithm = "exact";
-                        stats.alg_index = 0;
+                        return nullptr;
                     }
-                    else if (next_algorithm.compare("naive") == 0)
+                    auto const elapsed_load = std::chrono::high_resolution_clock::now() - start_load;
+                    std::cout << "\033[93mLoaded the R-tree index in "
+                              << std::chrono::duration< double >(elapsed_load).count() << " s (fanout " << index->fanout()
+                              << ", depth " << index->depth() << ", " << index->num_nodes() << " nodes)\033[00m" << std::endl;
+                    if (vm.count(ARG_INDEX_MEMORY))
                     {
-                        alg = new Heuristic< Heuristic_Variant::Naive >(corpus);
-                        stats.algorithm = next_algorithm;
-                        stats.alg_index = 1;
+                        index->printMemory(std::cout);
                     }
-                    else if (next_algorithm.compare("dist") == 0)
+                    if (vm.count(ARG_INDEX_QUALITY))
                     {
-                        alg = new Heuristic< Heuristic_Variant::Naive_dist >(corpus);
-                        stats.algorithm = next_algorithm;
-                        stats.alg_index = 2;
+                        index->printQuality(std::cout);
                     }
-                    else if (next_algorithm.compare("user") == 0)
+                }
+                if (parameters.page_file.empty() && (!index || index->stale(corpus)))
+                {
+                    auto const start_build = std::chrono::high_resolution_clock::now();
+                    index = Index::create(parameters.fanout);
+                    index->buildIndex(corpus, parameters.build);
+                    auto const elapsed_build = std::chrono::high_resolution_clock::now() - start_build;
+                    std::cout << "\033[93mBuilt the R-tree index once in "
+                              << std::chrono::duration< double >(elapsed_build).count() << " s ("
+                              << vm[ARG_RTREE_BUILD].as< std::string >() << ", fanout " << parameters.fanout << ", depth "
+                              << index->depth() << ", " << index->num_nodes() << " nodes)\033[00m" << std::endl;
+                    if (vm.count(ARG_INDEX_MEMORY))
                     {
-                        alg = new Heuristic< Heuristic_Variant::Naive_user >(corpus);
-                        stats.algorithm = next_algorithm;
-                        stats.alg_index = 3;
+                        index->printMemory(std::cout);
                     }
-                    else if (next_algorithm.compare("lp") == 0)
+                    if (vm.count(ARG_INDEX_QUALITY))
                     {
-                        alg = new Lp< LP_Variant::LP >(corpus);
-                        stats.algorithm = next_algorithm;
-                        stats.alg_index = 4;
+                        index->printQuality(std::cout);
                     }
-                    else if (next_algorithm.compare("ilp") == 0)
+                    // with --append, the index is saved once the batches are applied
+                    if (!vm.count(ARG_APPEND) && !parameters.save_index.empty() && index->save(parameters.save_index, corpus) == 1)
                     {
-                        alg = new Lp< LP_Variant::Ilp >(corpus);
-                        stats.algorithm = next_algorithm;
-                        stats.alg_index = 5;
+                        return nullptr;
                     }
-                    else if (next_algorithm.compare("greedy") == 0)
+                }
+                return index;
+            };
+
+            // the quadtree of the corpus, built on first use and shared by all quadtree queries
+            std::shared_ptr< Index > quadtree;
+            auto const shared_quadtree = [ &quadtree, &corpus, &parameters, &vm ]() -> std::shared_ptr< Index const >
+            {
+                if (!quadtree || quadtree->stale(corpus))
+                {
+                    auto const start_build = std::chrono::high_resolution_clock::now();
+                    quadtree.reset(new QuadIndex(parameters.fanout));
+                    quadtree->buildIndex(corpus);
+                    auto const elapsed_build = std::chrono::high_resolution_clock::now() - start_build;
+                    std::cout << "\033[93mBuilt the quadtree index once in "
+                              << std::chrono::duration< double >(elapsed_build).count() << " s (capacity "
+                              << parameters.fanout << ", depth " << quadtree->depth() << ", " << quadtree->num_nodes()
+                              << " nodes)\033[00m" << std::endl;
+                    if (vm.count(ARG_INDEX_MEMORY))
                     {
-                        alg = new Greedy< Greedy_Variant::Naive >(corpus);
-                        stats.algorithm = next_algorithm;
-                        stats.alg_index = 6;
+                        quadtree->printMemory(std::cout);
                     }
-                    else if (next_algorithm.compare("rtree") == 0)
+                    if (vm.count(ARG_INDEX_QUALITY))
                     {
+                        quadtree->printQuality(std::cout);
+                    }
+                }
+                return quadtree;
+            };
+
+            if (vm.count(ARG_APPEND))
+            {
+                // the indexes are built before the batches and updated in place with each one
+                bool uses_index = false, uses_quadtree = false;
+                std::istringstream names(vm[ARG_ALGORITHM].as< std::string >());
+                for (std::string name; names >> name; )
+                {
+                    uses_index = uses_index || name == "rtree" || name == "re-heap";
+                    uses_quadtree = uses_quadtree || name == "quadtree";
+                }
+                if (uses_index && parameters.page_file.empty() && !shared_index())
+                {
+                    return 1;
+                }
+                if (uses_quadtree)
+                {
+                    shared_quadtree();
+                }
+
+                CorpusUpdater updater(corpus);
+                for (auto batch : vm[ARG_APPEND].as< std::vector< std::string > >())
+                {
+                    InputReader ir;
+                    if (ir.appendFile(batch, updater) == 1)
+                    {
+                        return 1;
+                    }
+                    updater.apply();
+                    std::cout << "\033[93mAppended " << updater.new_checkins() << " check-ins (" << updater.new_places()
+                              << " new POIs, " << updater.new_users() << " new users) from " << batch << " in "
+                              << ir.seconds() + updater.seconds() << " s\033[00m" << std::endl;
+                    if (index)
+                    {
+                        auto const start_update = std::chrono::high_resolution_clock::now();
+                        index->update(corpus, updater.changed_places(), updater.new_places());
+                        auto const elapsed_update = std::chrono::high_resolution_clock::now() - start_update;
+                        std::cout << "\033[93mUpdated the R-tree index with " << updater.changed_places().size()
+                                  << " POIs in " << std::chrono::duration< double >(elapsed_update).count() << " s\033[00m" << std::endl;
+                    }
+                    if (quadtree)
+                    {
+                        auto const start_update = std::chrono::high_resolution_clock::now();
+                        quadtree->update(corpus, updater.changed_places(), updater.new_places());
+                        auto const elapsed_update = std::chrono::high_resolution_clock::now() - start_update;
+                        std::cout << "\033[93mUpdated the quadtree index with " << updater.changed_places().size()
+                                  << " POIs in " << std::chrono::duration< double >(elapsed_update).count() << " s\033[00m" << std::endl;
+                    }
+                }
+                if (quadtree)
+                {
+                    quadtree->compact();
+                }
+                if (index)
+                {
+                    index->compact();
+                    if (!parameters.save_index.empty() && index->save(parameters.save_index, corpus) == 1)
+                    {
+                        return 1;
+                    }
+                }
+            }
+
+            std::cout << tag_headers << std::endl << tag_rule << std::endl;
+            while (parameters.algorithms >> next_algorithm)
+            {
+                uint32_t query_index = 1;
+                std::unordered_map< std::string, std::vector< long double > > batches;
+                if (next_algorithm.compare("exact") == 0)
+                {
+                    alg.reset(new Exact(corpus));
+                    stats.algorithm = "exact";
+                    stats.alg_index = 0;
+                }
+                else if (next_algorithm.compare("naive") == 0)
+                {
+                    alg.reset(new Heuristic< Heuristic_Variant::Naive >(corpus));
+                    stats.algorithm = next_algorithm;
+                    stats.alg_index = 1;
+                }
+                else if (next_algorithm.compare("dist") == 0)
+                {
+                    alg.reset(new Heuristic< Heuristic_Variant::Naive_dist >(corpus));
+                    stats.algorithm = next_algorithm;
+                    stats.alg_index = 2;
+                }
+                else if (next_algorithm.compare("user") == 0)
+                {
+                    alg.reset(new Heuristic< Heuristic_Variant::Naive_user >(corpus));
+                    stats.algorithm = next_algorithm;
+                    stats.alg_index = 3;
+                }
+                else if (next_algorithm.compare("lp") == 0)
+                {
+                    alg.reset(new Lp< LP_Variant::LP >(corpus));
+                    stats.algorithm = next_algorithm;
+                    stats.alg_index = 4;
+                }
+                else if (next_algorithm.compare("ilp") == 0)
+                {
+                    alg.reset(new Lp< LP_Variant::Ilp >(corpus));
+                    stats.algorithm = next_algorithm;
+                    stats.alg_index = 5;
+                }
+                else if (next_algorithm.compare("greedy") == 0)
+                {
+                    alg.reset(new Greedy< Greedy_Variant::Naive >(corpus));
+                    stats.algorithm = next_algorithm;
+                    stats.alg_index = 6;
+                }
+                else if (next_algorithm.compare("rtree") == 0)
+                {
 #ifdef NPRUNE
-                        std::cout << "\033[93mThe flag NPRUNE is set. There won't be any pruning checks on the tree.\033[00m" << std::endl;
+                    std::cout << "\033[93mThe flag NPRUNE is set. There won't be any pruning checks on the tree.\033[00m" << std::endl;
 #endif
-                        alg = new Indexed< Indexed_Variant::Naive >(corpus);
-                        stats.algorithm = next_algorithm;
-                        stats.alg_index = 7;
+                    auto const rtree_index = shared_index();
+                    if (!rtree_index && parameters.page_file.empty())
+                    {
+                        return 1;
                     }
-                    else if (next_algorithm.compare("re-heap") == 0)
+                    auto indexed = new Indexed< Indexed_Variant::Naive >(corpus, rtree_index, parameters.search);
+                    alg.reset(indexed);
+                    if (!parameters.page_file.empty() && indexed->openPages(parameters.page_file, parameters.buffer_pages) == 1)
                     {
+                        return 1;
+                    }
+                    stats.algorithm = next_algorithm;
+                    stats.alg_index = 7;
+                }
+                else if (next_algorithm.compare("re-heap") == 0)
+                {
 #ifdef NPRUNE
-                        std::cout << "\033[93mThe flag NPRUNE is set. There won't be any pruning checks on the tree.\033[00m" << std::endl;
+                    std::cout << "\033[93mThe flag NPRUNE is set. There won't be any pruning checks on the tree.\033[00m" << std::endl;
 #endif
-                        alg = new Indexed< Indexed_Variant::ReHeap >(corpus);
-                        stats.algorithm = next_algorithm;
-                        stats.alg_index = 8;
+                    auto const rtree_index = shared_index();
+                    if (!rtree_index && parameters.page_file.empty())
+                    {
+                        return 1;
                     }
-                    else
+                    auto indexed = new Indexed< Indexed_Variant::ReHeap >(corpus, rtree_index, parameters.search);
+                    alg.reset(indexed);
+                    if (!parameters.page_file.empty() && indexed->openPages(parameters.page_file, parameters.buffer_pages) == 1)
                     {
-                        std::cout << "Algorithm " << next_algorithm << " unknown." << std::endl;
-                        std::cout << desc << std::endl;
-                        return 0;
+                        return 1;
                     }
+                    stats.algorithm = next_algorithm;
+                    stats.alg_index = 8;
+                }
+                else if (next_algorithm.compare("quadtree") == 0)
+                {
+#ifdef NPRUNE
+                    std::cout << "\033[93mThe flag NPRUNE is set. There won't be any pruning checks on the tree.\033[00m" << std::endl;
+#endif
+                    // the re-heap search over the quadtree instead of the R-tree
+                    alg.reset(new Indexed< Indexed_Variant::ReHeap >(corpus, shared_quadtree(), parameters.search));
+                    stats.algorithm = next_algorithm;
+                    stats.alg_index = 9;
+                }
+                else
+                {
+                    std::cout << "Algorithm " << next_algorithm << " unknown." << std::endl;
+                    std::cout << desc << std::endl;
+                    return 0;
+                }
+
+                for (auto const& q : parameters.query_points)
+                {
 
                     stats.query = q;
                     stats.query_index = query_index;
                     stats.k = parameters.k;
                     stats.a = parameters.a;
-                    stats.num_points = corpus.places.size();
-                    stats.num_users = corpus.users.size();
+                    stats.num_points = corpus.num_places();
+                    stats.num_users = corpus.num_users();
                     stats.num_checkins = corpus.num_checkins;
                     ResultSet results;
                     double z_from_lp;
                     uint32_t prunes;
                     uint32_t reheaps;
 
-                    uint32_t kk = (parameters.k >= corpus.places.size()) ? corpus.places.size() : parameters.k;
+                    stats.page_hits = stats.page_misses = 0;
+                    stats.tree_depth = stats.tree_nodes = stats.nodes_expanded = 0;
+
+                    uint32_t kk = (parameters.k >= corpus.num_places()) ? corpus.num_places() : parameters.k;
                     auto start_preprocess = std::chrono::high_resolution_clock::now();
                     alg->preprocess(q, kk, parameters.a);
                     auto const elapsed_preprocess = std::chrono::high_resolution_clock::now() - start_preprocess;
@@ -256,6 +560,8 @@ int main( int argc, char** argv ) {
                     alg->query(kk, q, parameters.a, results, z_from_lp, prunes, reheaps);
                     auto const elapsed_q = std::chrono::high_resolution_clock::now() - start_q;
 
+                    alg->fill_stats(stats);
+
                     auto start_retrieve = std::chrono::high_resolution_clock::now();
                     alg->retrieve_results(kk, q, parameters.a, results, z_from_lp);
                     auto const elapsed_retrieve = std::chrono::high_resolution_clock::now() - start_retrieve;
@@ -289,8 +595,12 @@ int main( int argc, char** argv ) {
                     batches["score"].push_back(stats.actual_score);
                     batches["prunes"].push_back(stats.prunes);
                     batches["reheaps"].push_back(stats.reheaps);
+                    batches["page hits"].push_back(stats.page_hits);
+                    batches["page misses"].push_back(stats.page_misses);
+                    batches["depth"].push_back(stats.tree_depth);
+                    batches["nodes"].push_back(stats.tree_nodes);
+                    batches["expanded"].push_back(stats.nodes_expanded);
 
-                    delete alg;
                 }
 
                 // batched stats
@@ -305,6 +615,11 @@ int main( int argc, char** argv ) {
                 stats.actual_score = sum(batches["score"]);
                 stats.prunes = median(batches["prunes"]);
                 stats.reheaps = median(batches["reheaps"]);
+                stats.page_hits = median(batches["page hits"]);
+                stats.page_misses = median(batches["page misses"]);
+                stats.tree_depth = median(batches["depth"]);
+                stats.tree_nodes = median(batches["nodes"]);
+                stats.nodes_expanded = median(batches["expanded"]);
                 std::cout << stats << std::endl;
                 outWriter.writeResults(stats);
             }
@@ -13,6 +13,8 @@
 
 #include <algorithm>
 #include <functional>
+#include <utility>
+#include <vector>
 
 #define ASSERT assert // RTree uses ASSERT( condition )
 #ifndef Min
@@ -64,9 +66,18 @@ public:
   {
     MAXNODES = TMAXNODES,                         ///< Max elements in node
     MINNODES = TMINNODES,                         ///< Min elements in node
+    REINSERTNODES = (TMAXNODES + 1) * 3 / 10 > 0 ? (TMAXNODES + 1) * 3 / 10 : 1, ///< Elements reinserted by RSTAR on overflow
+  };
+
+  /// How Insert places new entries
+  enum InsertPolicy
+  {
+    QUADRATIC,                                    ///< Guttman: least volume enlargement, quadratic split
+    RSTAR,                                        ///< R*-tree: least overlap enlargement, margin/overlap split, forced reinsertion
   };
 
     struct Node;  // Fwd decl.  Used by other internal structs and iterator
+    struct Branch;  // Fwd decl.  Used by BulkLoad
 
 public:
 
@@ -79,12 +90,33 @@ public:
   /// \param a_max Max of bounding rect
   /// \param a_dataId Positive Id of data.  Maybe zero, but negative numbers not allowed.
   void Insert(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], const DATATYPE& a_dataId);
+
+  /// Replace the contents with a tree packed bottom-up by Sort-Tile-Recursive (STR)
+  /// \param a_entries The data entries; only m_rect and m_data are used
+  /// \param a_regroup If set, called on the data entries once they are in STR order, to reorder
+  /// them before they are cut into leaves of MAXNODES entries
+  void BulkLoad(std::vector<Branch> a_entries, std::function<void(Branch*, Branch*)> a_regroup = nullptr);
+
+  /// Set how the following calls to Insert place their entries; QUADRATIC by default
+  void SetInsertPolicy(InsertPolicy a_policy)     { m_policy = a_policy; }
+  InsertPolicy GetInsertPolicy() const            { return m_policy; }
   
   /// Remove entry
   /// \param a_min Min of bounding rect
   /// \param a_max Max of bounding rect
   /// \param a_dataId Positive Id of data.  Maybe zero, but negative numbers not allowed.
-  void Remove(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], const DATATYPE& a_dataId);
+  /// \return Returns true if the entry was found and removed
+  bool Remove(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], const DATATYPE& a_dataId);
+
+  /// The nodes that Insert and Remove change, for structures derived from the tree
+  struct Changes
+  {
+    std::vector<std::pair<Node*, bool>> m_nodes; ///< In order: a node whose branches changed or that is new (false),
+                                                  ///< or a node that was deleted (true); a new node may reuse the address
+  };
+
+  /// Record the changes of the following updates into a_changes, until set to NULL
+  void SetChanges(Changes* a_changes)             { m_changes = a_changes; }
   
   /// Find all within search rectangle
   /// \param a_min Min of search bounding rect
@@ -333,6 +365,14 @@ protected:
     Rect m_coverSplit;
     ELEMTYPEREAL m_coverSplitArea;
   };
+
+  /// The entries an RSTAR insertion still has to place, and the levels that already
+  /// had their forced reinsertion during this insertion
+  struct ReinsertVars
+  {
+    std::vector<std::pair<Branch, int>> m_pending; ///< Entry and level to insert it at
+    std::vector<bool> m_reinserted;               ///< By level
+  };
  
   Node* AllocNode();
   void FreeNode(Node* a_node);
@@ -362,6 +402,7 @@ protected:
   bool Overlap(Rect* a_rectA, Rect* a_rectB) const;
   void ReInsert(Node* a_node, ListNode** a_listNode);
   bool Search(Node* a_node, Rect* a_rect, int& a_foundCount, std::function<bool (const DATATYPE&)> callback) const;
+  void Changed(Node* a_node, bool a_freed = false) { if(m_changes) { m_changes->m_nodes.emplace_back(a_node, a_freed); } }
   void RemoveAllRec(Node* a_node);
   void Reset();
   void CountRec(Node* a_node, int& a_count);
@@ -371,8 +412,20 @@ protected:
   void CopyRec(Node* current, Node* other);
 
   void PrintNode(const Node* a_node) const;
+  void StrOrder(Branch* a_first, Branch* a_last, int a_dim);
+
+  void InsertRStar(const Branch& a_branch, int a_level);
+  bool InsertRectRStar(const Branch& a_branch, Node** a_root, int a_level, ReinsertVars* a_vars);
+  bool InsertRectRStarRec(const Branch& a_branch, Node* a_node, Node** a_newNode, int a_level, ReinsertVars* a_vars);
+  bool AddBranchRStar(const Branch* a_branch, Node* a_node, Node** a_newNode, ReinsertVars* a_vars);
+  int PickBranchRStar(const Rect* a_rect, Node* a_node);
+  void SplitNodeRStar(Node* a_node, const Branch* a_branch, Node** a_newNode);
+  ELEMTYPEREAL RectMargin(const Rect* a_rect) const;
+  ELEMTYPEREAL OverlapVolume(const Rect* a_rectA, const Rect* a_rectB) const;
 
   Node* m_root;                                    ///< Root of tree
+  InsertPolicy m_policy;                           ///< Used by Insert
+  Changes* m_changes;                              ///< Where to record changed nodes, if set
   ELEMTYPEREAL m_unitSphereVolume;                 ///< Unit sphere constant for required number of dimensions
 };
 
@@ -530,8 +583,10 @@ RTREE_QUAL::RTree()
     0.082146f, 0.046622f, 0.025807f, // Dimension  18,19,20
   };
 
+  m_changes = NULL;
   m_root = AllocNode();
   m_root->m_level = 0;
+  m_policy = QUADRATIC;
   m_unitSphereVolume = (ELEMTYPEREAL)UNIT_SPHERE_VOLUMES[NUMDIMS];
 }
 
@@ -539,6 +594,7 @@ RTREE_QUAL::RTree()
 RTREE_TEMPLATE
 RTREE_QUAL::RTree(const RTree& other) : RTree()
 {
+	m_policy = other.m_policy;
 	CopyRec(m_root, other.m_root);
 }
 
@@ -570,12 +626,19 @@ void RTREE_QUAL::Insert(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMD
     branch.m_rect.m_max[axis] = a_max[axis];
   }
 
-  InsertRect(branch, &m_root, 0);
+  if(m_policy == RSTAR)
+  {
+    InsertRStar(branch, 0);
+  }
+  else
+  {
+    InsertRect(branch, &m_root, 0);
+  }
 }
 
 
 RTREE_TEMPLATE
-void RTREE_QUAL::Remove(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], const DATATYPE& a_dataId)
+bool RTREE_QUAL::Remove(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], const DATATYPE& a_dataId)
 {
 #ifdef _DEBUG
   for(int index=0; index<NUMDIMS; ++index)
@@ -592,7 +655,7 @@ void RTREE_QUAL::Remove(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMD
     rect.m_max[axis] = a_max[axis];
   }
 
-  RemoveRect(&rect, a_dataId, &m_root);
+  return !RemoveRect(&rect, a_dataId, &m_root);
 }
 
 
@@ -722,8 +785,12 @@ bool RTREE_QUAL::Load(RTFileStream& a_stream)
 RTREE_TEMPLATE
 bool RTREE_QUAL::LoadRec(Node* a_node, RTFileStream& a_stream)
 {
-  a_stream.Read(a_node->m_level);
-  a_stream.Read(a_node->m_count);
+  if(a_stream.Read(a_node->m_level) != 1 || a_stream.Read(a_node->m_count) != 1
+     || a_node->m_level < 0 || a_node->m_count < 0 || a_node->m_count > MAXNODES)
+  {
+    a_node->m_count = 0; // leave a valid node for RemoveAll()
+    return false;
+  }
 
   if(a_node->IsInternalNode())  // not a leaf node
   {
@@ -731,11 +798,20 @@ bool RTREE_QUAL::LoadRec(Node* a_node, RTFileStream& a_stream)
     {
       Branch* curBranch = &a_node->m_branch[index];
 
-      a_stream.ReadArray(curBranch->m_rect.m_min, NUMDIMS);
-      a_stream.ReadArray(curBranch->m_rect.m_max, NUMDIMS);
+      if(a_stream.ReadArray(curBranch->m_rect.m_min, NUMDIMS) != 1
+         || a_stream.ReadArray(curBranch->m_rect.m_max, NUMDIMS) != 1
+         || a_stream.Read(curBranch->id) != 1)
+      {
+        a_node->m_count = index;
+        return false;
+      }
 
       curBranch->m_child = AllocNode();
-      LoadRec(curBranch->m_child, a_stream);
+      if(!LoadRec(curBranch->m_child, a_stream) || curBranch->m_child->m_level != a_node->m_level - 1)
+      {
+        a_node->m_count = index + 1;
+        return false;
+      }
     }
   }
   else // A leaf node
@@ -744,14 +820,18 @@ bool RTREE_QUAL::LoadRec(Node* a_node, RTFileStream& a_stream)
     {
       Branch* curBranch = &a_node->m_branch[index];
 
-      a_stream.ReadArray(curBranch->m_rect.m_min, NUMDIMS);
-      a_stream.ReadArray(curBranch->m_rect.m_max, NUMDIMS);
-
-      a_stream.Read(curBranch->m_data);
+      if(a_stream.ReadArray(curBranch->m_rect.m_min, NUMDIMS) != 1
+         || a_stream.ReadArray(curBranch->m_rect.m_max, NUMDIMS) != 1
+         || a_stream.Read(curBranch->id) != 1
+         || a_stream.Read(curBranch->m_data) != 1)
+      {
+        a_node->m_count = index;
+        return false;
+      }
     }
   }
 
-  return true; // Should do more error checking on I/O operations
+  return true;
 }
 
 
@@ -859,6 +939,7 @@ bool RTREE_QUAL::SaveRec(Node* a_node, RTFileStream& a_stream)
 
       a_stream.WriteArray(curBranch->m_rect.m_min, NUMDIMS);
       a_stream.WriteArray(curBranch->m_rect.m_max, NUMDIMS);
+      a_stream.Write(curBranch->id);
 
       SaveRec(curBranch->m_child, a_stream);
     }
@@ -871,6 +952,7 @@ bool RTREE_QUAL::SaveRec(Node* a_node, RTFileStream& a_stream)
 
       a_stream.WriteArray(curBranch->m_rect.m_min, NUMDIMS);
       a_stream.WriteArray(curBranch->m_rect.m_max, NUMDIMS);
+      a_stream.Write(curBranch->id);
 
       a_stream.Write(curBranch->m_data);
     }
@@ -891,6 +973,437 @@ void RTREE_QUAL::RemoveAll()
 }
 
 
+// Packs one level at a time: the entries are put in STR order, cut into runs of MAXNODES
+// (the last two nodes share the remainder so that no node has fewer than MINNODES
+// entries), and the covers of the new nodes become the entries of the next level.
+RTREE_TEMPLATE
+void RTREE_QUAL::BulkLoad(std::vector<Branch> a_entries, std::function<void(Branch*, Branch*)> a_regroup)
+{
+  RemoveAll();
+  if(a_entries.empty())
+  {
+    return;
+  }
+
+  for(auto& entry : a_entries)
+  {
+    entry.m_child = NULL;
+  }
+
+  for(int level = 0; ; ++level)
+  {
+    StrOrder(a_entries.data(), a_entries.data() + a_entries.size(), 0);
+    if(level == 0 && a_regroup)
+    {
+      a_regroup(a_entries.data(), a_entries.data() + a_entries.size());
+    }
+
+    const size_t count = a_entries.size();
+    const size_t numNodes = (count + MAXNODES - 1) / MAXNODES;
+    const size_t lastStart = (numNodes - 1) * MAXNODES;
+    const size_t split = (numNodes > 1 && count - lastStart < (size_t)MINNODES) ? count - MINNODES : lastStart;
+
+    std::vector<Branch> parents(numNodes);
+    #pragma omp parallel for schedule(static)
+    for(size_t n = 0; n < numNodes; ++n)
+    {
+      const size_t first = (n + 1 == numNodes) ? split : n * MAXNODES;
+      const size_t last = (n + 1 == numNodes) ? count : (n + 2 == numNodes ? split : (n + 1) * MAXNODES);
+
+      Node* node = AllocNode();
+      node->m_level = level;
+      for(size_t i = first; i < last; ++i)
+      {
+        node->m_branch[node->m_count++] = a_entries[i];
+      }
+      parents[n].m_rect = NodeCover(node);
+      parents[n].m_child = node;
+      parents[n].m_data = DATATYPE();
+    }
+
+    if(numNodes == 1)
+    {
+      FreeNode(m_root);
+      m_root = parents[0].m_child;
+      return;
+    }
+    a_entries.swap(parents);
+  }
+}
+
+
+// Sorts the entries by the centre of dimension a_dim and, unless it is the last dimension,
+// cuts them into slabs of whole nodes that are ordered recursively by the next dimension.
+RTREE_TEMPLATE
+void RTREE_QUAL::StrOrder(Branch* a_first, Branch* a_last, int a_dim)
+{
+  std::sort(a_first, a_last, [a_dim](const Branch& a, const Branch& b)
+  {
+    return a.m_rect.m_min[a_dim] + a.m_rect.m_max[a_dim] < b.m_rect.m_min[a_dim] + b.m_rect.m_max[a_dim];
+  });
+  if(a_dim + 1 == NUMDIMS)
+  {
+    return;
+  }
+
+  const size_t count = a_last - a_first;
+  const size_t numNodes = (count + MAXNODES - 1) / MAXNODES;
+  const size_t numSlabs = (size_t)ceil(pow((double)numNodes, 1.0 / (NUMDIMS - a_dim)));
+  const size_t slabSize = (numNodes + numSlabs - 1) / numSlabs * MAXNODES;
+
+  #pragma omp parallel for schedule(dynamic) if(a_dim == 0)
+  for(size_t s = 0; s < numSlabs; ++s)
+  {
+    const size_t first = s * slabSize;
+    if(first < count)
+    {
+      StrOrder(a_first + first, a_first + std::min(count, first + slabSize), a_dim + 1);
+    }
+  }
+}
+
+
+// R*-tree insertion (Beckmann, Kriegel, Schneider, Seeger 1990). The first overflow of a
+// level other than the root during one insertion is not split: the REINSERTNODES entries
+// farthest from the center of the node are taken out and inserted again, closest first,
+// once the insertion that overflowed is done. Any further overflow of that level splits.
+RTREE_TEMPLATE
+void RTREE_QUAL::InsertRStar(const Branch& a_branch, int a_level)
+{
+  ReinsertVars vars;
+  vars.m_pending.emplace_back(a_branch, a_level);
+
+  // Entries are appended while the earlier ones are inserted
+  for(size_t index = 0; index < vars.m_pending.size(); ++index)
+  {
+    const std::pair<Branch, int> entry = vars.m_pending[index];
+    InsertRectRStar(entry.first, &m_root, entry.second, &vars);
+  }
+}
+
+
+// As InsertRect, growing the tree taller if the root was split
+RTREE_TEMPLATE
+bool RTREE_QUAL::InsertRectRStar(const Branch& a_branch, Node** a_root, int a_level, ReinsertVars* a_vars)
+{
+  ASSERT(a_root);
+  ASSERT(a_level >= 0 && a_level <= (*a_root)->m_level);
+
+  if(a_vars->m_reinserted.size() < (size_t)(*a_root)->m_level + 1)
+  {
+    a_vars->m_reinserted.resize((*a_root)->m_level + 1, false);
+  }
+
+  Node* newNode;
+  if(InsertRectRStarRec(a_branch, *a_root, &newNode, a_level, a_vars))
+  {
+    Node* newRoot = AllocNode();
+    newRoot->m_level = (*a_root)->m_level + 1;
+
+    Branch branch;
+    branch.m_rect = NodeCover(*a_root);
+    branch.m_child = *a_root;
+    AddBranch(&branch, newRoot, NULL);
+
+    branch.m_rect = NodeCover(newNode);
+    branch.m_child = newNode;
+    AddBranch(&branch, newRoot, NULL);
+
+    *a_root = newRoot;
+    return true;
+  }
+  return false;
+}
+
+
+// As InsertRectRec. A forced reinsertion shrinks a node, so the cover of the picked branch
+// is recomputed rather than only combined with the new rectangle.
+RTREE_TEMPLATE
+bool RTREE_QUAL::InsertRectRStarRec(const Branch& a_branch, Node* a_node, Node** a_newNode, int a_level, ReinsertVars* a_vars)
+{
+  ASSERT(a_node && a_newNode);
+  ASSERT(a_level >= 0 && a_level <= a_node->m_level);
+  Changed(a_node);
+
+  if(a_node->m_level > a_level)
+  {
+    Node* otherNode;
+    int index = PickBranchRStar(&a_branch.m_rect, a_node);
+    bool childWasSplit = InsertRectRStarRec(a_branch, a_node->m_branch[index].m_child, &otherNode, a_level, a_vars);
+
+    a_node->m_branch[index].m_rect = NodeCover(a_node->m_branch[index].m_child);
+    if(!childWasSplit)
+    {
+      return false;
+    }
+
+    Branch branch;
+    branch.m_child = otherNode;
+    branch.m_rect = NodeCover(otherNode);
+    return AddBranchRStar(&branch, a_node, a_newNode, a_vars);
+  }
+  return AddBranchRStar(&a_branch, a_node, a_newNode, a_vars);
+}
+
+
+// As AddBranch, with the overflow treatment of the R*-tree: forced reinsertion once per
+// level, a split otherwise. Returns true if the node was split.
+RTREE_TEMPLATE
+bool RTREE_QUAL::AddBranchRStar(const Branch* a_branch, Node* a_node, Node** a_newNode, ReinsertVars* a_vars)
+{
+  ASSERT(a_branch);
+  ASSERT(a_node);
+  Changed(a_node);
+
+  if(a_node->m_count < MAXNODES)
+  {
+    a_node->m_branch[a_node->m_count] = *a_branch;
+    ++a_node->m_count;
+    return false;
+  }
+
+  const int level = a_node->m_level;
+  if(level == m_root->m_level || a_vars->m_reinserted[level])
+  {
+    ASSERT(a_newNode);
+    SplitNodeRStar(a_node, a_branch, a_newNode);
+    return true;
+  }
+  a_vars->m_reinserted[level] = true;
+
+  Branch buf[MAXNODES + 1];
+  std::copy(a_node->m_branch, a_node->m_branch + MAXNODES, buf);
+  buf[MAXNODES] = *a_branch;
+
+  Rect cover = buf[0].m_rect;
+  for(int index = 1; index < MAXNODES + 1; ++index)
+  {
+    cover = CombineRect(&cover, &buf[index].m_rect);
+  }
+
+  // Order the entries by the distance of their center to the center of the node
+  ELEMTYPEREAL dist[MAXNODES + 1];
+  int order[MAXNODES + 1];
+  for(int index = 0; index < MAXNODES + 1; ++index)
+  {
+    dist[index] = (ELEMTYPEREAL)0;
+    for(int axis = 0; axis < NUMDIMS; ++axis)
+    {
+      const ELEMTYPEREAL delta = ((ELEMTYPEREAL)buf[index].m_rect.m_min[axis] + (ELEMTYPEREAL)buf[index].m_rect.m_max[axis]
+                                - (ELEMTYPEREAL)cover.m_min[axis] - (ELEMTYPEREAL)cover.m_max[axis]) * 0.5f;
+      dist[index] += delta * delta;
+    }
+    order[index] = index;
+  }
+  std::stable_sort(order, order + MAXNODES + 1, [&dist](int a, int b) { return dist[a] < dist[b]; });
+
+  const int keep = MAXNODES + 1 - REINSERTNODES;
+  a_node->m_count = 0;
+  for(int index = 0; index < keep; ++index)
+  {
+    a_node->m_branch[a_node->m_count++] = buf[order[index]];
+  }
+  for(int index = keep; index < MAXNODES + 1; ++index)
+  {
+    a_vars->m_pending.emplace_back(buf[order[index]], level);
+  }
+  return false;
+}
+
+
+// Pick a branch the R*-tree way. Above the nodes that hold leaves, as PickBranch but by
+// actual area. For the nodes whose children are leaves, pick the branch whose enlargement
+// adds the least overlap with its siblings; only the RSTAR_CANDIDATES branches of least area
+// enlargement are tried, as the overlap costs quadratic time in the fan-out.
+RTREE_TEMPLATE
+int RTREE_QUAL::PickBranchRStar(const Rect* a_rect, Node* a_node)
+{
+  ASSERT(a_rect && a_node && a_node->m_count > 0);
+
+  const int RSTAR_CANDIDATES = 32;
+
+  ELEMTYPEREAL increase[MAXNODES];
+  ELEMTYPEREAL area[MAXNODES];
+  int order[MAXNODES];
+  for(int index = 0; index < a_node->m_count; ++index)
+  {
+    Rect tempRect = CombineRect(a_rect, &a_node->m_branch[index].m_rect);
+    area[index] = RectVolume(&a_node->m_branch[index].m_rect);
+    increase[index] = RectVolume(&tempRect) - area[index];
+    order[index] = index;
+  }
+  auto const byIncrease = [&](int a, int b)
+  {
+    return increase[a] < increase[b] || (increase[a] == increase[b] && area[a] < area[b]);
+  };
+
+  if(a_node->m_level > 1)
+  {
+    return *std::min_element(order, order + a_node->m_count, byIncrease);
+  }
+
+  int candidates = a_node->m_count;
+  if(candidates > RSTAR_CANDIDATES)
+  {
+    std::partial_sort(order, order + RSTAR_CANDIDATES, order + a_node->m_count, byIncrease);
+    candidates = RSTAR_CANDIDATES;
+  }
+
+  int best = 0; // set by the first candidate
+  ELEMTYPEREAL bestOverlap = (ELEMTYPEREAL)0;
+  for(int c = 0; c < candidates; ++c)
+  {
+    const int index = order[c];
+    const Rect* curRect = &a_node->m_branch[index].m_rect;
+    Rect tempRect = CombineRect(a_rect, curRect);
+    ELEMTYPEREAL overlap = (ELEMTYPEREAL)0;
+    for(int other = 0; other < a_node->m_count; ++other)
+    {
+      if(other != index)
+      {
+        overlap += OverlapVolume(&tempRect, &a_node->m_branch[other].m_rect)
+                 - OverlapVolume(curRect, &a_node->m_branch[other].m_rect);
+      }
+    }
+    if(c == 0 || overlap < bestOverlap || (overlap == bestOverlap && byIncrease(index, best)))
+    {
+      best = index;
+      bestOverlap = overlap;
+    }
+  }
+  return best;
+}
+
+
+// Split a node the R*-tree way. The split axis is the one whose sorted distributions have
+// the least total margin; along it, the distribution with the least overlap between the
+// two groups is taken, or the least total area on a tie. The entries are sorted by their
+// lower and by their upper values, and each group gets at least MINNODES of them.
+RTREE_TEMPLATE
+void RTREE_QUAL::SplitNodeRStar(Node* a_node, const Branch* a_branch, Node** a_newNode)
+{
+  ASSERT(a_node);
+  ASSERT(a_branch);
+
+  const int total = MAXNODES + 1;
+  Branch buf[MAXNODES + 1];
+  std::copy(a_node->m_branch, a_node->m_branch + MAXNODES, buf);
+  buf[MAXNODES] = *a_branch;
+
+  Rect lower[MAXNODES + 1]; // lower[i] covers the sorted entries [0, i]
+  Rect upper[MAXNODES + 1]; // upper[i] covers the sorted entries [i, total)
+  auto const sortAndCover = [&](int a_axis, bool a_byMax)
+  {
+    std::stable_sort(buf, buf + total, [a_axis, a_byMax](Branch const& a, Branch const& b)
+    {
+      return a_byMax ? (a.m_rect.m_max[a_axis] < b.m_rect.m_max[a_axis]
+                        || (a.m_rect.m_max[a_axis] == b.m_rect.m_max[a_axis] && a.m_rect.m_min[a_axis] < b.m_rect.m_min[a_axis]))
+                     : (a.m_rect.m_min[a_axis] < b.m_rect.m_min[a_axis]
+                        || (a.m_rect.m_min[a_axis] == b.m_rect.m_min[a_axis] && a.m_rect.m_max[a_axis] < b.m_rect.m_max[a_axis]));
+    });
+    lower[0] = buf[0].m_rect;
+    for(int index = 1; index < total; ++index)
+    {
+      lower[index] = CombineRect(&lower[index - 1], &buf[index].m_rect);
+    }
+    upper[total - 1] = buf[total - 1].m_rect;
+    for(int index = total - 1; index-- > 0; )
+    {
+      upper[index] = CombineRect(&upper[index + 1], &buf[index].m_rect);
+    }
+  };
+
+  // Choose the split axis
+  int bestAxis = 0;
+  ELEMTYPEREAL bestMargin = (ELEMTYPEREAL)0;
+  for(int axis = 0; axis < NUMDIMS; ++axis)
+  {
+    ELEMTYPEREAL margin = (ELEMTYPEREAL)0;
+    for(int byMax = 0; byMax < 2; ++byMax)
+    {
+      sortAndCover(axis, byMax == 1);
+      for(int first = MINNODES; first <= total - MINNODES; ++first)
+      {
+        margin += RectMargin(&lower[first - 1]) + RectMargin(&upper[first]);
+      }
+    }
+    if(axis == 0 || margin < bestMargin)
+    {
+      bestAxis = axis;
+      bestMargin = margin;
+    }
+  }
+
+  // Choose the split index along it
+  bool bestByMax = false;
+  int bestFirst = MINNODES;
+  ELEMTYPEREAL bestOverlap = (ELEMTYPEREAL)0;
+  ELEMTYPEREAL bestArea = (ELEMTYPEREAL)0;
+  for(int byMax = 0; byMax < 2; ++byMax)
+  {
+    sortAndCover(bestAxis, byMax == 1);
+    for(int first = MINNODES; first <= total - MINNODES; ++first)
+    {
+      const ELEMTYPEREAL overlap = OverlapVolume(&lower[first - 1], &upper[first]);
+      const ELEMTYPEREAL area = RectVolume(&lower[first - 1]) + RectVolume(&upper[first]);
+      if((byMax == 0 && first == MINNODES) || overlap < bestOverlap || (overlap == bestOverlap && area < bestArea))
+      {
+        bestByMax = byMax == 1;
+        bestFirst = first;
+        bestOverlap = overlap;
+        bestArea = area;
+      }
+    }
+  }
+  sortAndCover(bestAxis, bestByMax);
+
+  *a_newNode = AllocNode();
+  (*a_newNode)->m_level = a_node->m_level;
+  a_node->m_count = 0;
+  for(int index = 0; index < total; ++index)
+  {
+    Node* target = index < bestFirst ? a_node : *a_newNode;
+    target->m_branch[target->m_count++] = buf[index];
+  }
+}
+
+
+// The sum of the extents of a rectangle, half its perimeter in 2D
+RTREE_TEMPLATE
+ELEMTYPEREAL RTREE_QUAL::RectMargin(const Rect* a_rect) const
+{
+  ASSERT(a_rect);
+
+  ELEMTYPEREAL margin = (ELEMTYPEREAL)0;
+  for(int index = 0; index < NUMDIMS; ++index)
+  {
+    margin += (ELEMTYPEREAL)a_rect->m_max[index] - (ELEMTYPEREAL)a_rect->m_min[index];
+  }
+  return margin;
+}
+
+
+// The volume of the intersection of two rectangles, zero if they are disjoint
+RTREE_TEMPLATE
+ELEMTYPEREAL RTREE_QUAL::OverlapVolume(const Rect* a_rectA, const Rect* a_rectB) const
+{
+  ASSERT(a_rectA && a_rectB);
+
+  ELEMTYPEREAL volume = (ELEMTYPEREAL)1;
+  for(int index = 0; index < NUMDIMS; ++index)
+  {
+    const ELEMTYPEREAL extent = (ELEMTYPEREAL)Min(a_rectA->m_max[index], a_rectB->m_max[index])
+                              - (ELEMTYPEREAL)Max(a_rectA->m_min[index], a_rectB->m_min[index]);
+    if(extent <= (ELEMTYPEREAL)0)
+    {
+      return (ELEMTYPEREAL)0;
+    }
+    volume *= extent;
+  }
+  return volume;
+}
+
+
 RTREE_TEMPLATE
 void RTREE_QUAL::Reset()
 {
@@ -931,6 +1444,7 @@ typename RTREE_QUAL::Node* RTREE_QUAL::AllocNode()
   // EXAMPLE
 #endif // RTREE_DONT_USE_MEMPOOLS
   InitNode(newNode);
+  Changed(newNode);
   return newNode;
 }
 
@@ -939,6 +1453,7 @@ RTREE_TEMPLATE
 void RTREE_QUAL::FreeNode(Node* a_node)
 {
   ASSERT(a_node);
+  Changed(a_node, true);
 
 #ifdef RTREE_DONT_USE_MEMPOOLS
   delete a_node;
@@ -1003,6 +1518,7 @@ bool RTREE_QUAL::InsertRectRec(const Branch& a_branch, Node* a_node, Node** a_ne
 {
   ASSERT(a_node && a_newNode);
   ASSERT(a_level >= 0 && a_level <= a_node->m_level);
+  Changed(a_node);
 
   // recurse until we reach the correct level for the new record. data records
   // will always be called with a_level == 0 (leaf)
@@ -1126,6 +1642,7 @@ bool RTREE_QUAL::AddBranch(const Branch* a_branch, Node* a_node, Node** a_newNod
 {
   ASSERT(a_branch);
   ASSERT(a_node);
+  Changed(a_node);
 
   if(a_node->m_count < MAXNODES)  // Split won't be necessary
   {
@@ -1149,6 +1666,7 @@ void RTREE_QUAL::DisconnectBranch(Node* a_node, int a_index)
 {
   ASSERT(a_node && (a_index >= 0) && (a_index < MAXNODES));
   ASSERT(a_node->m_count > 0);
+  Changed(a_node);
 
   // Remove element by swapping with the last element to prevent gaps in array
   a_node->m_branch[a_index] = a_node->m_branch[a_node->m_count - 1];
@@ -1551,9 +2069,16 @@ bool RTREE_QUAL::RemoveRect(Rect* a_rect, const DATATYPE& a_id, Node** a_root)
       for(int index = 0; index < tempNode->m_count; ++index)
       {
         // TODO go over this code. should I use (tempNode->m_level - 1)?
-        InsertRect(tempNode->m_branch[index],
-                   a_root,
-                   tempNode->m_level);
+        if(m_policy == RSTAR && a_root == &m_root)
+        {
+          InsertRStar(tempNode->m_branch[index], tempNode->m_level);
+        }
+        else
+        {
+          InsertRect(tempNode->m_branch[index],
+                     a_root,
+                     tempNode->m_level);
+        }
       }
       
       ListNode* remLNode = reInsertList;
@@ -1604,6 +2129,7 @@ bool RTREE_QUAL::RemoveRectRec(Rect* a_rect, const DATATYPE& a_id, Node* a_node,
           {
             // child removed, just resize parent rect
             a_node->m_branch[index].m_rect = NodeCover(a_node->m_branch[index].m_child);
+            Changed(a_node);
           }
           else
           {
@@ -0,0 +1,128 @@
+/**
+ * @file
+ * The best-first search shared by the in-memory and the disk-resident R-tree.
+ */
+
+#ifndef POPULAR_BEST_FIRST
+#define POPULAR_BEST_FIRST
+
+#include <vector>
+
+#include "../util/commons.hpp"
+#include "index.hpp"
+
+namespace popular
+{
+    /**
+     * Finds the k POIs of the result one at a time: the best scored branch is dequeued and,
+     * unless it is pruned or bounded again, an internal branch is expanded and a POI is added
+     * to the result if its contribution is still the best.
+     *
+     * The tree is reached through an accessor of type Tree, which takes the branches as queued
+     * by Queue and provides
+     *  - open( queue, intermediateRes ), which queues the branches of the root;
+     *  - is_leaf( branch );
+     *  - covered( branch, coverage ), whether all the users below the branch are covered;
+     *  - contribution( branch, intermediateRes ), as contribution() for the users below it;
+     *  - rebound(), whether an internal branch is bounded again when it is dequeued;
+     *  - expand( branch, queue, intermediateRes ), which queues the branches of its child node;
+     *  - accept( branch, results, intermediateRes ), which adds the POI of a leaf branch;
+     *  - failed(), whether the tree could not be read, which ends the search.
+     * @param expanded : receives the number of nodes expanded, the root included
+     */
+    template < Indexed_Variant variant, typename Tree, typename Queue >
+    void bestFirst( Tree &tree, Queue &queue, ResultSet &results, float const a, uint32_t const k,
+                    uint32_t const tot_users, uint32_t &prunes, uint32_t &reheaps, uint32_t &expanded )
+    {
+        reheaps = 0;
+        expanded = 1; // the root
+        IntermediateRes intermediateRes{ Coverage( tot_users ), 0.0 };
+        uint32_t found = 0;
+        using Branch = typename decltype( queue.return_best() )::first_type;
+        std::vector< Branch > pruned; // set aside for good when a == 0, unless the queue runs dry
+        bool may_prune = true;
+
+        tree.open( queue, intermediateRes );
+
+        while( found < k && !tree.failed() )
+        {
+            if( queue.isEmpty() )
+            {
+                if( pruned.empty() ) { break; }
+                // every candidate left contributes nothing, so fill the result from the pruned ones
+                for( auto const& branch : pruned ) { queue.add_to_queue( branch, 0.0 ); }
+                pruned.clear();
+                may_prune = false;
+            }
+            auto const [ branch, min_score ] = queue.return_best(); // dequeue the best scored element
+
+#ifndef NPRUNE
+            // a covered POI only matters if it contributes nothing, i.e. if a == 0
+            bool const may_prune_branch = may_prune && !intermediateRes.coverage.empty() && ( a == 0 || !tree.is_leaf( branch ) );
+            if( may_prune_branch && tree.covered( branch, intermediateRes.coverage ) )
+            {
+                if( a == 0 ) // contributes nothing, now or later
+                {
+                    if( intermediateRes.coverage.size() < tot_users ) // else neither does anything else
+                    {
+                        pruned.push_back( branch );
+                        prunes++;
+                        continue;
+                    }
+                }
+                else if( !tree.is_leaf( branch ) ) // can only contribute its distance
+                {
+                    double const distance_only = tree.contribution( branch, intermediateRes );
+                    if( !queue.isEmpty() && distance_only < queue.peak_best_score() )
+                    {
+                        queue.add_to_queue( branch, distance_only );
+                        prunes++;
+                        continue;
+                    }
+                }
+            }
+#endif
+
+            if( tree.rebound() && !tree.is_leaf( branch ) && !intermediateRes.coverage.empty() && !queue.isEmpty() )
+            {
+                // the coverage may have grown since the branch was queued
+                double const rebound = tree.contribution( branch, intermediateRes );
+                if( rebound < queue.peak_best_score() )
+                {
+                    queue.add_to_queue( branch, rebound );
+                    reheaps++;
+                    continue;
+                }
+            }
+
+            if( !tree.is_leaf( branch ) ) // is internal node
+            {
+                // add all children to the queue
+                ++expanded;
+                tree.expand( branch, queue, intermediateRes );
+            }
+            else // is point
+            {
+                // recompute the contribution of the point
+                double const contribution = ( variant == Indexed_Variant::Naive
+                                            ? min_score
+                                            : tree.contribution( branch, intermediateRes ) );
+
+                if( contribution == min_score || queue.isEmpty() || contribution > queue.peak_best_score() )
+                {
+                    // add POI to result and intermediate
+                    tree.accept( branch, results, intermediateRes );
+                    ++found;
+                }
+                else if( variant == Indexed_Variant::ReHeap ) // reheap the point
+                {
+                    queue.add_to_queue( branch, contribution );
+                    reheaps++;
+                }
+            }
+        }
+    }
+
+} // namespace popular
+
+#endif
@@ -0,0 +1,1214 @@
+/**
+ * @file
+ * Implementation of the R-tree index.
+ */
+
+#include "index.hpp"
+#include "pagedIndex.hpp"
+#include "bestFirst.hpp"
+#include "../util/commons.hpp"
+#include "../util/MBRPriorityQueue.hpp"
+
+#include <algorithm> // std::max_element(), std::set_union(), std::partition_point()
+#include <array>
+#include <cmath> // std::sqrt()
+#include <fstream>
+#include <iterator> // std::back_inserter()
+#include <cstring> // std::memset(), std::memcpy()
+#include <unordered_map>
+#include <unordered_set>
+
+namespace popular
+{
+    namespace // anonymous
+    {
+        std::vector< UserId > decoded( UserList const users ) { return std::vector< UserId >( users.begin(), users.end() ); }
+        std::vector< UserId > decoded( UserSet const& users ) { return users.decode(); }
+
+        size_t uncovered( Coverage const& coverage, UserList const users ) { return coverage.uncovered( users ); }
+        size_t uncovered( Coverage const& coverage, UserSet const& users ) { return users.count_not_in( coverage ); }
+        bool covered( Coverage const& coverage, UserList const users ) { return coverage.covers( users ); }
+        bool covered( Coverage const& coverage, UserSet const& users ) { return users.subset_of( coverage ); }
+        void addTo( Coverage &coverage, UserList const users ) { coverage.add( users ); }
+        void addTo( Coverage &coverage, UserSet const& users ) { users.add_to( coverage ); }
+
+        /**
+         * Regroups POI entries in STR order into nodes of max_nodes entries that share users.
+         * Each window of Constants::RTREE_SOCIAL_WINDOW nodes' worth of consecutive, hence
+         * nearby, entries is regrouped on its own: a node starts from the first entry left and
+         * then takes the entry of least cost, which weighs the growth of the node's margin
+         * (relative to that of the window) against the Jaccard distance between the users of
+         * the entry and the users of the node so far.
+         */
+        template < typename Branch >
+        void groupByUsers( Branch *first, Branch *last, size_t const max_nodes, Corpus const& corpus )
+        {
+            size_t const count = last - first;
+            size_t const window = Constants::RTREE_SOCIAL_WINDOW * max_nodes;
+            size_t const num_windows = ( count + window - 1 ) / window;
+            double const w = Constants::RTREE_SOCIAL_SPATIAL_WEIGHT;
+
+            #pragma omp parallel
+            {
+                std::vector< uint32_t > stamp( corpus.num_users(), 0u ); // the users of the current node have its stamp
+                uint32_t node = 0;
+                std::vector< Branch > grouped;
+                std::vector< bool > taken;
+
+                #pragma omp for schedule( dynamic )
+                for( size_t win = 0; win < num_windows; ++win )
+                {
+                    Branch *const begin = first + win * window;
+                    size_t const n = std::min( count, ( win + 1 ) * window ) - win * window;
+
+                    float lo[ NumDims ], hi[ NumDims ];
+                    for( int d = 0; d < NumDims; ++d ) { lo[ d ] = begin[ 0 ].m_rect.m_min[ d ]; hi[ d ] = begin[ 0 ].m_rect.m_max[ d ]; }
+                    for( size_t i = 1; i < n; ++i )
+                    {
+                        for( int d = 0; d < NumDims; ++d )
+                        {
+                            lo[ d ] = std::min( lo[ d ], begin[ i ].m_rect.m_min[ d ] );
+                            hi[ d ] = std::max( hi[ d ], begin[ i ].m_rect.m_max[ d ] );
+                        }
+                    }
+                    double extent = 0.0;
+                    for( int d = 0; d < NumDims; ++d ) { extent += hi[ d ] - lo[ d ]; }
+                    if( extent <= 0.0 ) { extent = 1.0; }
+
+                    grouped.clear();
+                    taken.assign( n, false );
+                    size_t seed = 0;
+                    while( grouped.size() < n )
+                    {
+                        while( taken[ seed ] ) { ++seed; }
+                        ++node;
+                        float node_lo[ NumDims ], node_hi[ NumDims ]; // the MBR of the node, from its seed on
+                        for( int d = 0; d < NumDims; ++d ) { node_lo[ d ] = begin[ seed ].m_rect.m_min[ d ]; node_hi[ d ] = begin[ seed ].m_rect.m_max[ d ]; }
+                        size_t union_size = 0;
+                        auto const take = [ & ]( size_t const i )
+                        {
+                            taken[ i ] = true;
+                            grouped.push_back( begin[ i ] );
+                            for( UserId const u : corpus.checkins( begin[ i ].m_data ) )
+                            {
+                                union_size += stamp[ u ] != node;
+                                stamp[ u ] = node;
+                            }
+                            for( int d = 0; d < NumDims; ++d )
+                            {
+                                node_lo[ d ] = std::min( node_lo[ d ], begin[ i ].m_rect.m_min[ d ] );
+                                node_hi[ d ] = std::max( node_hi[ d ], begin[ i ].m_rect.m_max[ d ] );
+                            }
+                        };
+                        take( seed );
+
+                        for( size_t size = 1; size < max_nodes && grouped.size() < n; ++size )
+                        {
+                            size_t best = n;
+                            double best_cost = 0.0;
+                            for( size_t i = 0; i < n; ++i )
+                            {
+                                if( taken[ i ] ) { continue; }
+                                UserList const users = corpus.checkins( begin[ i ].m_data );
+                                size_t shared = 0;
+                                for( UserId const u : users ) { shared += stamp[ u ] == node; }
+                                size_t const joint = users.size() + union_size - shared;
+                                double const jaccard = joint == 0 ? 1.0 : shared / static_cast< double >( joint );
+
+                                double growth = 0.0;
+                                for( int d = 0; d < NumDims; ++d )
+                                {
+                                    growth += std::max( node_hi[ d ], begin[ i ].m_rect.m_max[ d ] ) - node_hi[ d ]
+                                            + node_lo[ d ] - std::min( node_lo[ d ], begin[ i ].m_rect.m_min[ d ] );
+                                }
+                                double const cost = w * growth / extent + ( 1 - w ) * ( 1 - jaccard );
+                                if( best == n || cost < best_cost ) { best = i; best_cost = cost; }
+                            }
+                            take( best );
+                        }
+                    }
+                    std::copy( grouped.begin(), grouped.end(), begin );
+                }
+            }
+        }
+    } // namespace anonymous
+
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::print() const
+    {
+        rtree.Print();
+
+        std::cout << "  USERS : " << std::endl;
+        for(uint32_t i = 0; i < users.size(); i++)
+        {
+            std::cout << "   mbr id = " << i << "  users.size = " << users[i].size()
+                      << "  bytes = " << users[i].bytes() << std::endl;
+        }
+    }
+
+    /**
+     * Numbers the nodes breadth-first, so that the children of a node are written next to
+     * each other, and lays the user aggregates out by branch id after the node pages.
+     */
+    template < int MaxNodes >
+    int BasicIndex< MaxNodes >::writePages(std::string const& filename, const Corpus& corpus) const
+    {
+        if( updated_ )
+        {
+            std::cerr << "The index was updated since it was built; compact() it before writing pages." << std::endl;
+            return 1;
+        }
+        std::ofstream out( filename, std::ios::binary | std::ios::trunc );
+        if( !out )
+        {
+            std::cerr << "Could not open page file for writing: " << filename << std::endl;
+            return 1;
+        }
+
+        std::vector< typename Tree::Node const* > nodes{ rtree.GetRoot() };
+        std::unordered_map< typename Tree::Node const*, uint32_t > numbers{ { rtree.GetRoot(), 0u } };
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            if( nodes[ n ]->IsLeaf() ) { continue; }
+            for( int i = 0; i < nodes[ n ]->m_count; ++i )
+            {
+                numbers.emplace( nodes[ n ]->m_branch[ i ].m_child, static_cast< uint32_t >( nodes.size() ) );
+                nodes.push_back( nodes[ n ]->m_branch[ i ].m_child );
+            }
+        }
+
+        PagedIndexHeader header;
+        std::memset( &header, 0, sizeof( header ) );
+        std::memcpy( header.magic, Constants::PAGED_INDEX_MAGIC, sizeof( header.magic ) );
+        header.version = Constants::PAGED_INDEX_VERSION;
+        header.header_size = sizeof( PagedIndexHeader );
+        header.page_size = Constants::DISK_PAGE_SIZE;
+        header.max_nodes = MaxNodes;
+        header.num_nodes = nodes.size();
+        header.num_branches = flat.size();
+        header.nodes_offset = Constants::DISK_PAGE_SIZE;
+        size_t const record = node_size( MaxNodes );
+        size_t const per_page = Constants::DISK_PAGE_SIZE / record;
+        header.users_offset = header.nodes_offset
+                            + ( nodes.size() + per_page - 1 ) / per_page * Constants::DISK_PAGE_SIZE;
+        header.num_places = corpus.num_places();
+        header.num_users = corpus.num_users();
+        header.num_entries = corpus.num_entries();
+        header.fingerprint = corpus.fingerprint();
+
+        std::vector< uint64_t > users_offsets( flat.size() );
+        std::vector< uint32_t > users_sizes( flat.size() );
+        uint64_t offset = header.users_offset;
+        for( uint32_t id = 0; id < flat.size(); ++id )
+        {
+            users_offsets[ id ] = offset;
+            users_sizes[ id ] = withUsers( id, []( auto const& u ){ return u.size(); } );
+            offset += users_sizes[ id ] * sizeof( UserId );
+        }
+        header.file_size = offset;
+
+        std::vector< char > page( Constants::DISK_PAGE_SIZE, '\0' );
+        std::memcpy( page.data(), &header, sizeof( header ) );
+        out.write( page.data(), page.size() );
+
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            PagedNode node;
+            std::memset( &node, 0, sizeof( node ) );
+            node.count = nodes[ n ]->m_count;
+            node.level = nodes[ n ]->m_level;
+            for( int i = 0; i < nodes[ n ]->m_count; ++i )
+            {
+                typename Tree::Branch const& branch = nodes[ n ]->m_branch[ i ];
+                PagedBranch &paged = node.branches[ i ];
+                for( int d = 0; d < NumDims; ++d )
+                {
+                    paged.min[ d ] = branch.m_rect.m_min[ d ];
+                    paged.max[ d ] = branch.m_rect.m_max[ d ];
+                }
+                paged.is_leaf = nodes[ n ]->IsLeaf();
+                paged.child = paged.is_leaf ? branch.m_data : numbers.at( branch.m_child );
+                paged.id = branch.id;
+                paged.users_offset = users_offsets[ branch.id ];
+                paged.num_users = users_sizes[ branch.id ];
+            }
+
+            size_t const slot = n % per_page;
+            if( slot == 0 ) { std::fill( page.begin(), page.end(), '\0' ); }
+            std::memcpy( page.data() + slot * record, &node, record );
+            if( slot + 1 == per_page || n + 1 == nodes.size() ) { out.write( page.data(), page.size() ); }
+        }
+
+        for( uint32_t id = 0; id < flat.size(); ++id )
+        {
+            std::vector< UserId > const u = withUsers( id, []( auto const& u ){ return decoded( u ); } );
+            out.write( reinterpret_cast< char const* >( u.data() ), u.size() * sizeof( UserId ) );
+        }
+
+        if( !out )
+        {
+            std::cerr << "Could not write page file: " << filename << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::buildIndex(const Corpus& corpus, Index_Build const build)
+    {
+        corpus_ = corpus;
+        rtree.SetInsertPolicy( build == Index_Build::RStar ? Tree::RSTAR : Tree::QUADRATIC );
+        if( build == Index_Build::STR || build == Index_Build::Social )
+        {
+            std::vector< typename Tree::Branch > entries( corpus.num_places() );
+            for(PoiId p = 0; p < corpus.num_places(); ++p)
+            {
+                entries[p].m_rect.m_min[0] = entries[p].m_rect.m_max[0] = corpus.xs[p];
+                entries[p].m_rect.m_min[1] = entries[p].m_rect.m_max[1] = corpus.ys[p];
+                entries[p].m_data = p;
+            }
+            if( build == Index_Build::Social )
+            {
+                rtree.BulkLoad( std::move( entries ), [ & ]( typename Tree::Branch *first, typename Tree::Branch *last ) {
+                    groupByUsers( first, last, MaxNodes, corpus );
+                } );
+            }
+            else
+            {
+                rtree.BulkLoad( std::move( entries ) );
+            }
+        }
+        else
+        {
+            for(PoiId p = 0; p < corpus.num_places(); ++p)
+            {
+                float m[2];
+                m[0] = corpus.xs[p];
+                m[1] = corpus.ys[p];
+                treeInsert(m, m, p);
+            }
+        }
+
+        updateUsers();
+        built_ = true;
+        version_ = corpus.version;
+    }
+
+    template < int MaxNodes >
+    int BasicIndex< MaxNodes >::save(std::string const& filename, const Corpus& corpus) const
+    {
+        if( updated_ )
+        {
+            std::cerr << "The index was updated since it was built; compact() it before saving." << std::endl;
+            return 1;
+        }
+        RTFileStream stream;
+        if( !stream.OpenWrite( filename.c_str() ) )
+        {
+            std::cerr << "Could not open index file for writing: " << filename << std::endl;
+            return 1;
+        }
+
+        IndexFileHeader header;
+        std::memset( &header, 0, sizeof( header ) );
+        std::memcpy( header.magic, Constants::INDEX_FILE_MAGIC, sizeof( header.magic ) );
+        header.version = Constants::INDEX_FILE_VERSION;
+        header.header_size = sizeof( IndexFileHeader );
+        header.fanout = MaxNodes;
+        header.num_branches = flat.size();
+        header.num_places = corpus.num_places();
+        header.num_users = corpus.num_users();
+        header.num_entries = corpus.num_entries();
+        header.fingerprint = corpus.fingerprint();
+
+        bool ok = stream.Write( header ) == 1;
+        ok = ok && const_cast< Tree& >( rtree ).Save( stream ); // RTree::Save() does not modify the tree
+        for( size_t id = 0; ok && id < users.size(); ++id )
+        {
+            std::vector< UserId > const decoded = users[ id ].decode();
+            uint32_t const n = decoded.size();
+            ok = stream.Write( n ) == 1 && ( n == 0 || stream.WriteArray( decoded.data(), n ) == 1 );
+        }
+        stream.Close();
+
+        if( !ok )
+        {
+            std::cerr << "Could not write index file: " << filename << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::unique_ptr< Index > Index::load(std::string const& filename, const Corpus& corpus)
+    {
+        RTFileStream stream;
+        if( !stream.OpenRead( filename.c_str() ) )
+        {
+            std::cerr << "Could not open index file for reading: " << filename << std::endl;
+            return nullptr;
+        }
+
+        IndexFileHeader header;
+        if( stream.Read( header ) != 1
+         || std::memcmp( header.magic, Constants::INDEX_FILE_MAGIC, sizeof( header.magic ) ) != 0
+         || header.version != Constants::INDEX_FILE_VERSION
+         || header.header_size != sizeof( IndexFileHeader ) )
+        {
+            std::cerr << "Not a compatible index file (expected version " << Constants::INDEX_FILE_VERSION
+                      << "): " << filename << std::endl;
+            return nullptr;
+        }
+        if( header.num_places != corpus.num_places() || header.num_users != corpus.num_users()
+         || header.num_entries != corpus.num_entries() || header.fingerprint != corpus.fingerprint() )
+        {
+            std::cerr << "Index file was built from a different corpus: " << filename << std::endl;
+            return nullptr;
+        }
+
+        std::unique_ptr< Index > index = create( header.fanout );
+        if( !index )
+        {
+            std::cerr << "Index file has an unsupported fanout of " << header.fanout << ": " << filename << std::endl;
+            return nullptr;
+        }
+        if( index->read( stream, header, corpus ) == 1 )
+        {
+            std::cerr << "Index file is truncated or corrupt: " << filename << std::endl;
+            return nullptr;
+        }
+        return index;
+    }
+
+    /**
+     * The saved branch ids must be the breadth-first numbers that flatten() gives the loaded
+     * tree, since the aggregates are stored in that order.
+     */
+    template < int MaxNodes >
+    int BasicIndex< MaxNodes >::read(RTFileStream &stream, IndexFileHeader const& header, const Corpus& corpus)
+    {
+        clear();
+        corpus_ = corpus;
+        if( !rtree.Load( stream ) )
+        {
+            clear();
+            return 1;
+        }
+
+        std::vector< typename Tree::Node* > nodes{ rtree.GetRoot() };
+        uint32_t id = 0;
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            for( int i = 0; i < nodes[ n ]->m_count; ++i )
+            {
+                typename Tree::Branch const& branch = nodes[ n ]->m_branch[ i ];
+                if( branch.id != id++ || ( nodes[ n ]->IsLeaf() && branch.m_data >= corpus.num_places() ) )
+                {
+                    clear();
+                    return 1;
+                }
+                if( !nodes[ n ]->IsLeaf() ) { nodes.push_back( branch.m_child ); }
+            }
+        }
+        if( id != header.num_branches )
+        {
+            clear();
+            return 1;
+        }
+
+        std::vector< std::vector< typename Tree::Node* > > levels( rtree.GetRoot()->m_level + 1 );
+        flatten( levels );
+        users.resize( flat.num_internal );
+        std::vector< UserId > u;
+        for( auto &set : users )
+        {
+            uint32_t n = 0;
+            if( stream.Read( n ) != 1 || n > corpus.num_users() )
+            {
+                clear();
+                return 1;
+            }
+            u.resize( n );
+            if( n > 0 && stream.ReadArray( u.data(), n ) != 1 )
+            {
+                clear();
+                return 1;
+            }
+            set = UserSet( u );
+        }
+
+        char extra;
+        if( stream.Read( extra ) == 1 ) // trailing bytes
+        {
+            clear();
+            return 1;
+        }
+
+        built_ = true;
+        version_ = corpus.version;
+        return 0;
+    }
+
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::clear()
+    {
+        rtree.RemoveAll();
+        flat = FlatTree();
+        users.clear();
+        slots_.clear();
+        free_slots_.clear();
+        corpus_ = Corpus();
+        built_ = false;
+        updated_ = false;
+    }
+
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::insert(const Corpus& corpus, PoiId const p)
+    {
+        trackSlots();
+        corpus_ = corpus;
+        version_ = corpus.version;
+
+        float m[2];
+        m[0] = corpus.xs[p];
+        m[1] = corpus.ys[p];
+        typename Tree::Changes changes;
+        rtree.SetChanges( &changes );
+        treeInsert(m, m, p);
+        rtree.SetChanges( nullptr );
+        applyChanges( changes );
+    }
+
+    template < int MaxNodes >
+    bool BasicIndex< MaxNodes >::remove(PoiId const p)
+    {
+        trackSlots();
+
+        float m[2];
+        m[0] = corpus_.xs[p];
+        m[1] = corpus_.ys[p];
+        typename Tree::Changes changes;
+        rtree.SetChanges( &changes );
+        bool const removed = rtree.Remove(m, m, p);
+        rtree.SetChanges( nullptr );
+        applyChanges( changes );
+        return removed;
+    }
+
+    /**
+     * The aggregates follow their branches to the new breadth-first numbers; none is recomputed.
+     */
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::compact()
+    {
+        if( !updated_ ) { return; }
+
+        std::vector< uint32_t > old_ids;
+        std::vector< typename Tree::Node* > nodes{ rtree.GetRoot() };
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            for( int i = 0; i < nodes[ n ]->m_count; ++i )
+            {
+                old_ids.push_back( nodes[ n ]->m_branch[ i ].id );
+                if( !nodes[ n ]->IsLeaf() ) { nodes.push_back( nodes[ n ]->m_branch[ i ].m_child ); }
+            }
+        }
+
+        std::vector< UserSet > old_users;
+        old_users.swap( users );
+        std::vector< std::vector< typename Tree::Node* > > levels( rtree.GetRoot()->m_level + 1 );
+        flatten( levels );
+        users.resize( flat.num_internal );
+        for( uint32_t b = 0; b < flat.num_internal; ++b )
+        {
+            users[ b ] = std::move( old_users[ old_ids[ b ] ] );
+        }
+    }
+
+    /**
+     * A compact tree is numbered breadth-first, each node in a slot of its own size.
+     */
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::trackSlots()
+    {
+        if( !slots_.empty() ) { return; }
+
+        std::vector< typename Tree::Node* > nodes{ rtree.GetRoot() };
+        uint32_t first = 0;
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            uint32_t const count = static_cast< uint32_t >( nodes[ n ]->m_count );
+            slots_.emplace( nodes[ n ], Slot{ first, count } );
+            first += count;
+            if( nodes[ n ]->IsLeaf() ) { continue; }
+            for( int i = 0; i < nodes[ n ]->m_count; ++i )
+            {
+                nodes.push_back( nodes[ n ]->m_branch[ i ].m_child );
+            }
+        }
+        users.resize( flat.size() );
+    }
+
+    /**
+     * The log of the tree says which nodes are still alive and changed. The aggregates of the
+     * branches whose child did not change are taken out before any slot is written, since the
+     * branches may have moved between nodes; a changed child is written before its parent,
+     * which then unites the users of its branches with usersBelow(). The slots of the deleted
+     * nodes, and those that a node outgrew, are only reused by later updates.
+     */
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::applyChanges(typename Tree::Changes const& changes)
+    {
+        using Node = typename Tree::Node;
+
+        std::unordered_map< Node*, size_t > changed; // the order of the first change, for a stable layout
+        std::vector< Slot > released;
+        for( auto const& [ node, freed ] : changes.m_nodes )
+        {
+            if( !freed )
+            {
+                changed.emplace( node, changed.size() );
+                continue;
+            }
+            changed.erase( node );
+            auto const slot = slots_.find( node );
+            if( slot != slots_.end() )
+            {
+                released.push_back( slot->second );
+                slots_.erase( slot );
+                --flat.num_nodes;
+            }
+        }
+
+        std::vector< Node* > nodes;
+        nodes.reserve( changed.size() );
+        for( auto const& entry : changed ) { nodes.push_back( entry.first ); }
+        std::sort( nodes.begin(), nodes.end(), [ &changed ]( Node const* a, Node const* b ) {
+            return a->m_level < b->m_level || ( a->m_level == b->m_level && changed.at( const_cast< Node* >( a ) ) < changed.at( const_cast< Node* >( b ) ) );
+        } );
+
+        std::vector< UserSet > kept_users( nodes.size() * MaxNodes );
+        std::vector< uint32_t > kept_max( nodes.size() * MaxNodes, 0u );
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            if( nodes[ n ]->IsLeaf() ) { continue; }
+            for( int i = 0; i < nodes[ n ]->m_count; ++i )
+            {
+                typename Tree::Branch const& branch = nodes[ n ]->m_branch[ i ];
+                if( changed.count( branch.m_child ) == 0 )
+                {
+                    kept_users[ n * MaxNodes + i ] = std::move( users[ branch.id ] );
+                    kept_max[ n * MaxNodes + i ] = flat.max_users[ branch.id ];
+                }
+            }
+        }
+
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            Node* const node = nodes[ n ];
+            auto const [ entry, added ] = slots_.emplace( node, Slot{ 0u, 0u } );
+            if( added ) { ++flat.num_nodes; }
+            if( entry->second.capacity < static_cast< uint32_t >( node->m_count ) )
+            {
+                if( entry->second.capacity > 0 ) { released.push_back( entry->second ); }
+                entry->second = newSlot( MaxNodes );
+            }
+            Slot const slot = entry->second;
+
+            for( int i = 0; i < node->m_count; ++i )
+            {
+                typename Tree::Branch &branch = node->m_branch[ i ];
+                uint32_t const b = slot.first + i;
+                branch.id = b;
+                for( int d = 0; d < NumDims; ++d )
+                {
+                    flat.min[ d ][ b ] = branch.m_rect.m_min[ d ];
+                    flat.max[ d ][ b ] = branch.m_rect.m_max[ d ];
+                }
+                if( node->IsLeaf() )
+                {
+                    flat.first[ b ] = branch.m_data;
+                    flat.count[ b ] = 0u;
+                    flat.max_users[ b ] = static_cast< uint32_t >( corpus_.checkins( branch.m_data ).size() );
+                    continue;
+                }
+
+                Slot const child = slots_.at( branch.m_child );
+                uint32_t const end = child.first + branch.m_child->m_count;
+                flat.first[ b ] = child.first;
+                flat.count[ b ] = static_cast< uint8_t >( branch.m_child->m_count );
+                if( changed.count( branch.m_child ) == 0 )
+                {
+                    users[ b ] = std::move( kept_users[ n * MaxNodes + i ] );
+                    flat.max_users[ b ] = kept_max[ n * MaxNodes + i ];
+                    continue;
+                }
+                users[ b ] = usersBelow( child.first, end );
+                flat.max_users[ b ] = child.first == end ? 0u
+                                    : *std::max_element( flat.max_users.begin() + child.first, flat.max_users.begin() + end );
+            }
+        }
+
+        releaseSlots( released, MaxNodes );
+
+        Node* const root = rtree.GetRoot();
+        flat.root_first = slots_.at( root ).first;
+        flat.root_count = root->m_count;
+        flat.depth = root->m_level + 1;
+        updated_ = true;
+    }
+
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::treeInsert(const ElemType a_min[NumDims], const ElemType a_max[NumDims], const DataType& a_dataId)
+    {
+        rtree.Insert(a_min, a_max, a_dataId);
+    }
+
+    /**
+     * Flattens the tree, then fills the aggregates of the internal branches bottom-up one
+     * level at a time: every node of a level only reads the aggregates of the level below, so
+     * the nodes of a level are processed in parallel. The leaves have no aggregates of their own.
+     */
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::updateUsers()
+    {
+        std::vector< std::vector< typename Tree::Node* > > levels( rtree.GetRoot()->m_level + 1 );
+        flatten(levels);
+        users.clear();
+        users.resize(flat.num_internal);
+
+        for(size_t level = 1; level < levels.size(); ++level)
+        {
+            auto const& nodes = levels[level];
+            #pragma omp parallel for schedule(dynamic, 16)
+            for(size_t n = 0; n < nodes.size(); ++n)
+            {
+                typename Tree::Node* const a_node = nodes[n];
+                for (int index = 0; index < a_node->m_count; ++index)
+                {
+                    uint32_t const b = a_node->m_branch[index].id;
+                    users[b] = usersBelow( flat.first[b], flat.first[b] + flat.count[b] );
+                }
+            }
+        }
+    }
+
+    /**
+     * Visiting the nodes breadth-first and their branches in order meets the children in the
+     * same order as they were queued, so the child of the i-th internal branch is node i + 1.
+     */
+    template < int MaxNodes >
+    void BasicIndex< MaxNodes >::flatten(std::vector< std::vector< typename Tree::Node* > > &levels)
+    {
+        std::vector< typename Tree::Node* > nodes{ rtree.GetRoot() };
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            levels[ nodes[ n ]->m_level ].push_back( nodes[ n ] );
+            if( nodes[ n ]->IsLeaf() ) { continue; }
+            for( int i = 0; i < nodes[ n ]->m_count; ++i )
+            {
+                nodes.push_back( nodes[ n ]->m_branch[ i ].m_child );
+            }
+        }
+
+        std::vector< uint32_t > node_first( nodes.size() + 1, 0u ); // the first branch of each node
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            node_first[ n + 1 ] = node_first[ n ] + nodes[ n ]->m_count;
+        }
+
+        uint32_t const num_branches = node_first.back();
+        flat = FlatTree();
+        for( int d = 0; d < NumDims; ++d )
+        {
+            flat.min[ d ].resize( num_branches );
+            flat.max[ d ].resize( num_branches );
+        }
+        flat.first.resize( num_branches );
+        flat.count.resize( num_branches );
+        flat.max_users.resize( num_branches );
+        flat.root_count = nodes[ 0 ]->m_count;
+        flat.num_internal = num_branches;
+        slots_.clear();
+        free_slots_.clear();
+        updated_ = false;
+        flat.num_nodes = static_cast< uint32_t >( nodes.size() );
+        flat.depth = nodes[ 0 ]->m_level + 1;
+
+        size_t child = 1;
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            for( int i = 0; i < nodes[ n ]->m_count; ++i )
+            {
+                typename Tree::Branch &branch = nodes[ n ]->m_branch[ i ];
+                uint32_t const b = node_first[ n ] + i;
+                branch.id = b;
+                for( int d = 0; d < NumDims; ++d )
+                {
+                    flat.min[ d ][ b ] = branch.m_rect.m_min[ d ];
+                    flat.max[ d ][ b ] = branch.m_rect.m_max[ d ];
+                }
+                if( nodes[ n ]->IsLeaf() )
+                {
+                    flat.num_internal = std::min( flat.num_internal, b );
+                    flat.first[ b ] = branch.m_data;
+                    flat.count[ b ] = 0u;
+                }
+                else
+                {
+                    flat.first[ b ] = node_first[ child ];
+                    flat.count[ b ] = static_cast< uint8_t >( nodes[ child ]->m_count );
+                    ++child;
+                }
+            }
+        }
+
+        fillMaxUsers();
+    }
+
+    void Index::fillMaxUsers()
+    {
+        flat.max_users.resize( flat.size() );
+        // the children of a branch follow it, so a reverse sweep sees them first
+        for( uint32_t b = static_cast< uint32_t >( flat.size() ); b-- > 0; )
+        {
+            if( flat.is_leaf( b ) )
+            {
+                flat.max_users[ b ] = static_cast< uint32_t >( corpus_.checkins( flat.first[ b ] ).size() );
+                continue;
+            }
+            uint32_t const end = flat.first[ b ] + flat.count[ b ];
+            flat.max_users[ b ] = *std::max_element( flat.max_users.begin() + flat.first[ b ], flat.max_users.begin() + end );
+        }
+    }
+
+    /**
+     * The corpus is taken even if nothing changed, so that the index is not stale. The POIs
+     * that only got check-ins are merged last, all at once, so that a set on many of their
+     * paths is decoded once per batch.
+     */
+    void Index::update(const Corpus& corpus, std::vector< PoiId > const& changed, size_t const new_places)
+    {
+        PoiId const first_new = static_cast< PoiId >( corpus.num_places() - new_places );
+        auto const old_places = std::partition_point( changed.begin(), changed.end(), [ first_new ]( PoiId const p ) { return p < first_new; } );
+        for( auto p = old_places; p != changed.end(); ++p ) { insert( corpus, *p ); }
+        corpus_ = corpus;
+        version_ = corpus.version;
+        addUsers( std::vector< PoiId >( changed.begin(), old_places ) );
+    }
+
+    bool Index::addCheckins(const Corpus& corpus, PoiId const p)
+    {
+        corpus_ = corpus;
+        version_ = corpus.version;
+        return addUsers( std::vector< PoiId >{ p } ) == 1;
+    }
+
+    /**
+     * The users of a POI hold all those its path had from it, so a set that holds all the
+     * users added to it is left as it is.
+     */
+    size_t Index::addUsers( std::vector< PoiId > const& pois )
+    {
+        std::unordered_map< uint32_t, std::vector< UserId > > added; // by internal branch
+        std::vector< uint32_t > path;
+        size_t found = 0;
+        for( PoiId const p : pois )
+        {
+            path.clear();
+            if( p >= corpus_.num_places() || !pathTo( p, flat.root_first, flat.root_first + flat.root_count, path ) ) { continue; }
+            ++found;
+            UserList const checkins = corpus_.checkins( p );
+            uint32_t const max_users = static_cast< uint32_t >( checkins.size() );
+            flat.max_users[ path.back() ] = max_users;
+            path.pop_back();
+            for( uint32_t const b : path )
+            {
+                flat.max_users[ b ] = std::max( flat.max_users[ b ], max_users );
+                added[ b ].insert( added[ b ].end(), checkins.begin(), checkins.end() );
+            }
+        }
+
+        for( auto &entry : added )
+        {
+            std::vector< UserId > &u = entry.second;
+            std::sort( u.begin(), u.end() );
+            u.erase( std::unique( u.begin(), u.end() ), u.end() );
+            UserSet &set = users[ entry.first ];
+            if( set.intersection_size( u ) == u.size() ) { continue; }
+            std::vector< UserId > const old = set.decode();
+            std::vector< UserId > merged;
+            merged.reserve( old.size() + u.size() );
+            std::set_union( old.begin(), old.end(), u.begin(), u.end(), std::back_inserter( merged ) );
+            set = UserSet( merged );
+        }
+        return found;
+    }
+
+    bool Index::pathTo( PoiId const p, uint32_t const first, uint32_t const end, std::vector< uint32_t > &path ) const
+    {
+        ElemType const coords[ NumDims ] = { static_cast< ElemType >( corpus_.xs[ p ] ), static_cast< ElemType >( corpus_.ys[ p ] ) };
+        for( uint32_t b = first; b < end; ++b )
+        {
+            if( flat.is_leaf( b ) )
+            {
+                if( flat.first[ b ] != p ) { continue; }
+                path.push_back( b );
+                return true;
+            }
+            bool holds = true;
+            for( int d = 0; d < NumDims; ++d ) { holds = holds && flat.min[ d ][ b ] <= coords[ d ] && coords[ d ] <= flat.max[ d ][ b ]; }
+            if( !holds ) { continue; }
+            path.push_back( b );
+            if( pathTo( p, flat.first[ b ], flat.first[ b ] + flat.count[ b ], path ) ) { return true; }
+            path.pop_back();
+        }
+        return false;
+    }
+
+    Index::Slot Index::newSlot(uint32_t const capacity)
+    {
+        if( !free_slots_.empty() )
+        {
+            uint32_t const first = free_slots_.back();
+            free_slots_.pop_back();
+            return Slot{ first, capacity };
+        }
+
+        uint32_t const first = static_cast< uint32_t >( flat.size() );
+        size_t const size = flat.size() + capacity;
+        for( int d = 0; d < NumDims; ++d )
+        {
+            flat.min[ d ].resize( size );
+            flat.max[ d ].resize( size );
+        }
+        flat.first.resize( size );
+        flat.count.resize( size, 0u );
+        flat.max_users.resize( size );
+        users.resize( size );
+        return Slot{ first, capacity };
+    }
+
+    void Index::releaseSlots(std::vector< Slot > const& released, uint32_t const capacity)
+    {
+        for( Slot const& slot : released )
+        {
+            for( uint32_t b = slot.first; b < slot.first + slot.capacity; ++b )
+            {
+                users[ b ] = UserSet();
+                flat.count[ b ] = 0u;
+            }
+            if( slot.capacity == capacity ) { free_slots_.push_back( slot.first ); }
+        }
+    }
+
+    UserSet Index::usersBelow( uint32_t const first, uint32_t const end ) const
+    {
+        Coverage below( corpus_.num_users() );
+        for( uint32_t c = first; c < end; ++c )
+        {
+            withUsers( c, [ &below ]( auto const& child_users ){ addTo( below, child_users ); } );
+        }
+        std::vector< UserId > u;
+        u.reserve( below.size() );
+        below.for_each( [ &u ]( UserId const user ){ u.push_back( user ); } );
+        return UserSet( u );
+    }
+
+    size_t Index::bytes() const
+    {
+        size_t total = flat.bytes() + users.capacity() * sizeof( UserSet );
+        for( auto const& u : users ) { total += u.bytes(); }
+        return total;
+    }
+
+    /**
+     * Walks the flat tree level by level: the children of the branches of one level are the
+     * nodes of the next, each a contiguous range of branches.
+     */
+    void Index::printMemory(std::ostream &o) const
+    {
+        size_t const branch_bytes = flat.size() == 0 ? 0 : flat.bytes() / flat.size();
+        o << "Level\tNodes\tBranches\tArrays\tBitmaps\tRuns\tUser set bytes\tBytes/node\tMax bytes/node" << std::endl;
+        size_t leaves = 0;
+
+        std::vector< std::pair< uint32_t, uint32_t > > nodes{ { flat.root_first, flat.root_first + flat.root_count } }; // [first, last) branches
+        for( uint32_t level = flat.depth; level-- > 0 && !nodes.empty(); )
+        {
+            std::vector< std::pair< uint32_t, uint32_t > > children;
+            size_t branches = 0, arrays = 0, bitmaps = 0, runs = 0, set_bytes = 0, max_node = 0;
+            for( auto const& [ first, last ] : nodes )
+            {
+                size_t node_bytes = ( last - first ) * branch_bytes;
+                for( uint32_t b = first; b < last; ++b )
+                {
+                    if( flat.is_leaf( b ) ) { ++leaves; continue; } // the check-ins of the corpus
+                    UserSet const& u = users[ b ];
+                    arrays += u.num_arrays();
+                    bitmaps += u.num_bitmaps();
+                    runs += u.num_runs();
+                    set_bytes += sizeof( UserSet ) + u.bytes();
+                    node_bytes += sizeof( UserSet ) + u.bytes();
+                    children.emplace_back( flat.first[ b ], flat.first[ b ] + flat.count[ b ] );
+                }
+                branches += last - first;
+                max_node = std::max( max_node, node_bytes );
+            }
+            o << level << "\t" << nodes.size() << "\t" << branches << "\t" << arrays << "\t" << bitmaps << "\t" << runs
+              << "\t" << set_bytes << "\t" << ( branches * branch_bytes + set_bytes ) / nodes.size() << "\t" << max_node << std::endl;
+            nodes.swap( children );
+        }
+        o << "Total: " << flat.bytes() << " bytes of tree and " << bytes() - flat.bytes() << " bytes of user sets;"
+          << " the users of the " << leaves << " leaf branches are the check-ins of the corpus" << std::endl;
+    }
+
+    /**
+     * The dead space of a node is estimated by inclusion-exclusion up to pairs of branches:
+     * its area minus the areas of its branches plus their pairwise overlaps.
+     */
+    void Index::printQuality(std::ostream &o) const
+    {
+        auto const area = []( double const lo[], double const hi[] ) {
+            double a = 1.0;
+            for( int d = 0; d < NumDims; ++d ) { a *= std::max( 0.0, hi[ d ] - lo[ d ] ); }
+            return a;
+        };
+        o << "Level\tNodes\tNode area\tOverlap\tDead space" << std::endl;
+
+        std::vector< std::pair< uint32_t, uint32_t > > nodes{ { flat.root_first, flat.root_first + flat.root_count } }; // [first, last) branches
+        for( uint32_t level = flat.depth; level-- > 0 && !nodes.empty(); )
+        {
+            std::vector< std::pair< uint32_t, uint32_t > > children;
+            double node_area = 0.0, overlap = 0.0, dead = 0.0;
+            for( auto const& [ first, last ] : nodes )
+            {
+                double lo[ NumDims ], hi[ NumDims ];
+                for( int d = 0; d < NumDims; ++d )
+                {
+                    lo[ d ] = *std::min_element( flat.min[ d ].begin() + first, flat.min[ d ].begin() + last );
+                    hi[ d ] = *std::max_element( flat.max[ d ].begin() + first, flat.max[ d ].begin() + last );
+                }
+                double const a = area( lo, hi );
+                double covered = 0.0, node_overlap = 0.0;
+                for( uint32_t b = first; b < last; ++b )
+                {
+                    double b_lo[ NumDims ], b_hi[ NumDims ];
+                    for( int d = 0; d < NumDims; ++d ) { b_lo[ d ] = flat.min[ d ][ b ]; b_hi[ d ] = flat.max[ d ][ b ]; }
+                    covered += area( b_lo, b_hi );
+                    for( uint32_t c = b + 1; c < last; ++c )
+                    {
+                        double c_lo[ NumDims ], c_hi[ NumDims ];
+                        for( int d = 0; d < NumDims; ++d )
+                        {
+                            c_lo[ d ] = std::max< double >( b_lo[ d ], flat.min[ d ][ c ] );
+                            c_hi[ d ] = std::min< double >( b_hi[ d ], flat.max[ d ][ c ] );
+                        }
+                        node_overlap += area( c_lo, c_hi );
+                    }
+                    if( !flat.is_leaf( b ) ) { children.emplace_back( flat.first[ b ], flat.first[ b ] + flat.count[ b ] ); }
+                }
+                node_area += a;
+                overlap += node_overlap;
+                dead += std::min( a, std::max( 0.0, a - covered + node_overlap ) );
+            }
+            o << level << "\t" << nodes.size() << "\t" << node_area
+              << "\t" << ( node_area > 0.0 ? overlap / node_area : 0.0 )
+              << "\t" << ( node_area > 0.0 ? dead / node_area : 0.0 ) << std::endl;
+            nodes.swap( children );
+        }
+    }
+
+    template < Indexed_Variant variant >
+    void Index::query(popular::ResultSet &results, Point const& q, float const& a, uint32_t const k,
+            double const& max_dist, uint32_t const& tot_users, uint32_t &prunes, uint32_t &reheaps,
+            uint32_t &expanded, SearchOptions const& options) const
+    {
+        switch( options.queue )
+        {
+        case Index_Queue::Dary:
+            search< variant, DaryMBRPriorityQueue< uint32_t > >( results, q, a, k, max_dist, tot_users, prunes, reheaps,
+                                                                 expanded, options );
+            break;
+        case Index_Queue::Bucket:
+            search< variant, BucketMBRPriorityQueue< uint32_t > >( results, q, a, k, max_dist, tot_users, prunes, reheaps,
+                                                                   expanded, options );
+            break;
+        default:
+            search< variant, MBRPriorityQueue >( results, q, a, k, max_dist, tot_users, prunes, reheaps,
+                                                 expanded, options );
+        }
+    }
+
+    template < Indexed_Variant variant, typename Queue >
+    void Index::search(popular::ResultSet &results, Point const& q, float const& a, uint32_t const k,
+            double const& max_dist, uint32_t const& tot_users, uint32_t &prunes, uint32_t &reheaps,
+            uint32_t &expanded, SearchOptions const& options) const
+    {
+        using Scores = std::array< double, Constants::RTREE_MAX_FANOUT >;
+
+        // the accessor of bestFirst() over flat
+        struct Tree
+        {
+            Index const& index;
+            Point const& q;
+            float const a;
+            uint32_t const k;
+            double const max_dist;
+            uint32_t const tot_users;
+            SearchOptions const& options;
+
+            void open( Queue &queue, IntermediateRes &intermediateRes ) const
+            {
+                FlatTree const& flat = index.flat;
+                for(uint32_t branch = flat.root_first; branch < flat.root_first + flat.root_count; ++branch)
+                {
+                    queue.add_to_queue(branch, index.scoreMBR(branch, q, a, k, max_dist, tot_users, intermediateRes, options.bound));
+                }
+            }
+
+            bool is_leaf( uint32_t const branch ) const { return index.flat.is_leaf( branch ); }
+            bool covered( uint32_t const branch, Coverage const& coverage ) const { return index.prune( branch, coverage ); }
+            bool rebound() const { return options.bound == Index_Bound::Lazy; }
+            bool failed() const { return false; }
+
+            double contribution( uint32_t const branch, IntermediateRes &intermediateRes ) const
+            {
+                return index.contributionMBR( branch, q, a, k, max_dist, tot_users, intermediateRes, options.bound );
+            }
+
+            void expand( uint32_t const branch, Queue &queue, IntermediateRes const& intermediateRes ) const
+            {
+                FlatTree const& flat = index.flat;
+                Scores scores;
+                index.scoreChildren( branch, q, a, k, max_dist, tot_users, intermediateRes, options.bound, scores.data() );
+                queue.add_to_queue( flat.first[ branch ], scores.data(), flat.count[ branch ] );
+            }
+
+            void accept( uint32_t const branch, ResultSet &results, IntermediateRes &intermediateRes ) const
+            {
+                FlatTree const& flat = index.flat;
+                Point const p( flat.min[0][branch], flat.min[1][branch] );
+                results.first.push_back( flat.first[branch] );
+                index.withUsers( branch, [ & ]( auto const& u ){ addIntermediate( intermediateRes, q, p, max_dist, u ); } );
+            }
+        };
+
+        Tree const tree{ *this, q, a, k, max_dist, tot_users, options };
+        Queue queue;
+        bestFirst< variant >( tree, queue, results, a, k, tot_users, prunes, reheaps, expanded );
+    }
+
+    double Index::scoreMBR( uint32_t const branch, Point const q, float const a, uint32_t const k,
+            double const max_dist, uint32_t const tot_users, IntermediateRes & intermediateRes, Index_Bound const bound ) const
+    {
+        Point const MBRpoi = minDistPoi(branch, q);
+        if( bound != Index_Bound::Union && !flat.is_leaf( branch ) )
+        {
+            double const d = ( 1 - distance( MBRpoi, q ) / max_dist + intermediateRes.distance ) / k;
+            double const u = ( intermediateRes.coverage.size() + maxPoiUsers( branch, intermediateRes.coverage ) )
+                           / static_cast< double >( tot_users );
+            return the_score( d, u, a );
+        }
+        return withUsers( branch, [ & ]( auto const& u ){ return score(q, MBRpoi, u, max_dist, k, tot_users, a, intermediateRes); } );
+    }
+
+    double Index::contributionMBR( uint32_t const branch, Point const q, float const a, uint32_t const k,
+                           double const max_dist, uint32_t const tot_users, IntermediateRes & intermediateRes,
+                           Index_Bound const bound ) const
+    {
+        Point MBRpoi = minDistPoi(branch, q);
+        if( bound != Index_Bound::Union && !flat.is_leaf( branch ) )
+        {
+            double const d = ( 1 - distance( MBRpoi, q ) / max_dist ) / k;
+            return the_score( d, maxPoiUsers( branch, intermediateRes.coverage ) / static_cast< double >( tot_users ), a );
+        }
+        return withUsers( branch, [ & ]( auto const& u ){ return contribution(q, MBRpoi, u, max_dist, k, tot_users, a, intermediateRes); } );
+    }
+
+    /**
+     * The distance part matches distance(): the differences are taken in float and squared in
+     * double, so the scores equal those of contributionMBR() bit for bit.
+     */
+    void Index::scoreChildren( uint32_t const branch, Point const q, float const a, uint32_t const k,
+            double const max_dist, uint32_t const tot_users, IntermediateRes const& intermediateRes,
+            Index_Bound const bound, double *scores ) const
+    {
+        uint32_t const first = flat.first[ branch ];
+        uint32_t const n = flat.count[ branch ];
+        ElemType const* const min_x = flat.min[ 0 ].data() + first;
+        ElemType const* const min_y = flat.min[ 1 ].data() + first;
+        ElemType const* const max_x = flat.max[ 0 ].data() + first;
+        ElemType const* const max_y = flat.max[ 1 ].data() + first;
+
+        // the squared distance from q to the closest point of each MBR, q clamped into it;
+        // sqrt() sets errno, so it is left to the scalar loop below to keep this one vectorised
+        #pragma omp simd
+        for( uint32_t i = 0; i < n; ++i )
+        {
+            double const dx = std::min( std::max( q.first, min_x[ i ] ), max_x[ i ] ) - q.first;
+            double const dy = std::min( std::max( q.second, min_y[ i ] ), max_y[ i ] ) - q.second;
+            scores[ i ] = dx * dx + dy * dy;
+        }
+
+        Coverage const& coverage = intermediateRes.coverage;
+        for( uint32_t i = 0; i < n; ++i )
+        {
+            uint32_t const child = first + i;
+            double const d = ( 1 - std::sqrt( scores[ i ] ) / max_dist ) / k;
+            size_t const gain = bound != Index_Bound::Union && !flat.is_leaf( child )
+                              ? maxPoiUsers( child, coverage )
+                              : withUsers( child, [ & ]( auto const& u ){ return coverage.empty() ? u.size() : uncovered( coverage, u ); } );
+            scores[ i ] = the_score( d, gain / static_cast< double >( tot_users ), a );
+        }
+    }
+
+    /**
+     * Each POI below the branch contributes at most its own users, all of which are below it.
+     */
+    size_t Index::maxPoiUsers( uint32_t const branch, Coverage const& coverage ) const
+    {
+        size_t const uncovered = coverage.empty() ? users[ branch ].size() : users[ branch ].count_not_in( coverage );
+        return std::min< size_t >( uncovered, flat.max_users[ branch ] );
+    }
+
+    Point Index::minDistPoi(uint32_t const branch, Point const& q) const
+    {
+        float const rx = std::min( std::max( q.first, flat.min[0][branch] ), flat.max[0][branch] );
+        float const ry = std::min( std::max( q.second, flat.min[1][branch] ), flat.max[1][branch] );
+        return std::make_pair(rx, ry);
+    }
+
+    /**
+     * The users are compared against the union of the users of all the chosen POIs, which
+     * only grows, so a branch that is covered stays covered for the rest of the query.
+     */
+    bool Index::prune(uint32_t const branch, Coverage const& coverage) const
+    {
+        return withUsers( branch, [ & ]( auto const& u ){ return covered( coverage, u ); } );
+    }
+
+    template void Index::query< Indexed_Variant::Naive >(popular::ResultSet &results, Point const& q, float const& a,
+            uint32_t const k, double const& max_dist, uint32_t const& tot_users, uint32_t &prunes, uint32_t &reheaps,
+            uint32_t &expanded, SearchOptions const& options) const;
+    template void Index::query< Indexed_Variant::ReHeap >(popular::ResultSet &results, Point const& q, float const& a,
+            uint32_t const k, double const& max_dist, uint32_t const& tot_users, uint32_t &prunes, uint32_t &reheaps,
+            uint32_t &expanded, SearchOptions const& options) const;
+
+    std::unique_ptr< Index > Index::create(uint32_t const fanout)
+    {
+        switch( fanout )
+        {
+            case 4: return std::unique_ptr< Index >( new BasicIndex< 4 >() );
+            case 8: return std::unique_ptr< Index >( new BasicIndex< 8 >() );
+            case 16: return std::unique_ptr< Index >( new BasicIndex< 16 >() );
+            case 32: return std::unique_ptr< Index >( new BasicIndex< 32 >() );
+            case 64: return std::unique_ptr< Index >( new BasicIndex< 64 >() );
+            default: return nullptr;
+        }
+    }
+
+    template class BasicIndex< 4 >;
+    template class BasicIndex< 8 >;
+    template class BasicIndex< 16 >;
+    template class BasicIndex< 32 >;
+    template class BasicIndex< 64 >;
+} // namespace popular
\ No newline at end of file
@@ -7,17 +7,25 @@
 #ifndef POPULAR_INDEX
 #define POPULAR_INDEX
 
+#include <string>
+#include <memory> // std::unique_ptr
+#include <unordered_map>
+
+#include "../util/commons.hpp"
 #include "../util/constants.hpp"
 #include "RTree.h"
 
 namespace popular
 {
-    using DataType = Point;
+    using DataType = PoiId;
     using ElemType = float;
     int const NumDims = 2;
-    using MyTree = RTree<DataType, ElemType, NumDims, float, Constants::RTREEMAXNODES>;
 
-    using Checks = std::unordered_map< Point, std::vector< UserId >, boost::hash< Point > >;
+    /**
+     * The representation of the users below a branch. HybridSet keeps the near-complete user
+     * sets of the upper levels as bitmaps or runs.
+     */
+    using UserSet = HybridSet;
 
     enum class Indexed_Variant
     {
@@ -26,77 +34,418 @@ namespace popular
         Other
     };
 
-    template < Indexed_Variant variant >
+    enum class Index_Build
+    {
+        Insert, /**< one POI at a time through RTree::Insert (quadratic splits) */
+        STR, /**< bulk-loaded by Sort-Tile-Recursive packing, with nearly full nodes */
+        Social, /**< as STR, with the POIs of neighbouring leaves regrouped by their shared users; experimental */
+        RStar /**< one POI at a time with the R*-tree policy: overlap-aware, with forced reinsertion */
+    };
+
+    /**
+     * How the users of an MBR are bounded in the best-first search. A POI never covers more
+     * users than the largest POI below the MBR, which is much smaller than the union of the
+     * users below the upper levels.
+     */
+    enum class Index_Bound
+    {
+        Union, /**< the uncovered users of the union below the branch */
+        MaxPoi, /**< the union, capped by the users of the largest single POI below the branch */
+        Lazy /**< as MaxPoi, and an internal branch is bounded again when it is dequeued */
+    };
+
+    /**
+     * The priority queue of the best-first search, see MBRPriorityQueue.hpp
+     */
+    enum class Index_Queue
+    {
+        Binary, /**< BasicMBRPriorityQueue, a binary heap */
+        Dary, /**< DaryMBRPriorityQueue, a 4-ary heap */
+        Bucket /**< BucketMBRPriorityQueue, buckets over the bits of the score */
+    };
+
+    /**
+     * How Index::query() searches the tree. None of these change the result of the re-heap
+     * variant, except the order of branches with equal scores for the queue. The naive variant
+     * adds a POI with the score it was queued with, so Index_Bound::Lazy, which changes the order
+     * in which the branches are expanded, can change the POIs it finds.
+     */
+    struct SearchOptions
+    {
+        Index_Bound bound = Index_Bound::Union; /**< how the users of the MBRs are bounded */
+        Index_Queue queue = Index_Queue::Binary;
+    };
+
+    /**
+     * A read-only copy of the R-tree for the best-first search. The branches are numbered
+     * breadth-first, so the branches of a node are contiguous and the nodes of a level follow
+     * each other; a branch number indexes the coordinate arrays and Index::users alike, and
+     * equals the id of the branch in the pointer tree.
+     * After Index::insert() or Index::remove(), the branches of a node are still contiguous, but
+     * the nodes they changed may have moved to slots of fan-out size at the end of the arrays,
+     * until Index::compact().
+     * QuadIndex numbers the nodes over cells before the nodes over POIs, as its leaves are not
+     * all at the same depth.
+     */
+    struct FlatTree
+    {
+        std::vector< ElemType > min[ NumDims ]; /**< the lower corner of each branch's MBR, one array per dimension */
+        std::vector< ElemType > max[ NumDims ]; /**< the upper corner of each branch's MBR, one array per dimension */
+        std::vector< uint32_t > first; /**< the first branch of the child node, or the POI id of a leaf branch */
+        std::vector< uint8_t > count; /**< the number of branches of the child node; 0 for a leaf branch */
+        std::vector< uint32_t > max_users; /**< the most users of a single POI below each branch */
+        uint32_t root_first = 0;
+        uint32_t root_count = 0; /**< the root node is branches [root_first, root_first + root_count) */
+        uint32_t num_internal = 0; /**< when compact, the internal branches are [0, num_internal); the leaf branches follow */
+        uint32_t num_nodes = 0;
+        uint32_t depth = 0; /**< the number of levels, counting the root and the leaves */
+
+        size_t size() const { return first.size(); }
+        bool is_leaf( uint32_t const b ) const { return count[ b ] == 0; }
+        size_t bytes() const { return size() * ( 2 * NumDims * sizeof( ElemType ) + 2 * sizeof( uint32_t ) + sizeof( uint8_t ) ); }
+    };
+
+    /**
+     * The header of an index file written by Index::save(). It is followed by the tree in the
+     * format of RTree::Save(), branch ids included, and then by the users below each internal
+     * branch in branch id order, each as a uint32 count and the sorted user ids.
+     */
+    struct IndexFileHeader
+    {
+        char magic[ 8 ]; /**< always Constants::INDEX_FILE_MAGIC */
+        uint32_t version; /**< Constants::INDEX_FILE_VERSION at the time of writing */
+        uint32_t header_size; /**< sizeof( IndexFileHeader ), as a sanity check */
+        uint32_t fanout;
+        uint32_t num_branches;
+        uint64_t num_places; /**< the corpus the index was built from, to detect a mismatch */
+        uint64_t num_users;
+        uint64_t num_entries;
+        uint64_t fingerprint; /**< Corpus::fingerprint() */
+    };
+
+    /**
+     * The R-tree over the POIs of a corpus with the users below each branch. It does not depend
+     * on the query variant, so one index is built per dataset and shared by all the queries of
+     * all the Indexed algorithms; querying does not modify it.
+     *
+     * The search only reads the flat copy of the tree, which does not depend on the fan-out;
+     * BasicIndex builds it from a pointer tree of a given fan-out, see Index::create().
+     */
     class Index
     {
     public:
-        Index() {}
-        ~Index() {}
+        virtual ~Index() {}
+
+        /**
+         * @return an empty index with the given number of branches per node, or nullptr if the
+         * fan-out is not one of Constants::RTREE_FANOUTS
+         */
+        static std::unique_ptr< Index > create(uint32_t const fanout);
+
+        /**
+         * Reads an index saved by save() instead of building it.
+         * @return the index, or nullptr if the file could not be read, is not a compatible
+         * index file or was built from a different corpus.
+         */
+        static std::unique_ptr< Index > load(std::string const& filename, const Corpus& corpus);
+
+        virtual void buildIndex(const Corpus& corpus, Index_Build const build = Index_Build::Insert) = 0;
+
+        /**
+         * Writes the tree, its branch ids and its user aggregates for load().
+         * @return 0 if successful; 1 if the file could not be written.
+         */
+        virtual int save(std::string const& filename, const Corpus& corpus) const = 0;
+
+        /**
+         * @return true if the index was not built from the current version of the corpus
+         */
+        bool stale(const Corpus& corpus) const { return !built_ || version_ != corpus.version; }
+
+        /**
+         * Removes all POIs and user aggregates, so that the index can be rebuilt.
+         */
+        virtual void clear() = 0;
+
+        /**
+         * Adds POI p of the corpus, e.g. one that CorpusUpdater::apply() added. Only the
+         * aggregates of the nodes that change are recomputed: the path to the new leaf branch,
+         * and the nodes that a split or a reinsertion creates or fills. The corpus must be the
+         * one the index was built from with POIs and check-ins added; it replaces it.
+         */
+        virtual void insert(const Corpus& corpus, PoiId const p) = 0;
 
-        void buildIndex(const PointsSet& places, const Checks& checkins);
+        /**
+         * Removes POI p from the index but not from the corpus, recomputing the aggregates of
+         * the path to it and of the nodes that condensing the tree changes.
+         * @return false if p is not in the index
+         */
+        virtual bool remove(PoiId const p) = 0;
+
+        /**
+         * Adds the users of POI p to the aggregates of the path to it, after check-ins to it were
+         * added to the corpus, which replaces the one of the index as for insert(). Each set is
+         * merged with the users of p in time linear in their sizes, and one that holds them all
+         * already is left as it is; the tree does not change.
+         * @return false if p is not in the index
+         */
+        bool addCheckins(const Corpus& corpus, PoiId const p);
+
+        /**
+         * Brings the index up to the corpus after an apply() of a CorpusUpdater: the new POIs
+         * among its changed_places() are inserted and the others added as by addCheckins().
+         * @param new_places : CorpusUpdater::new_places(), the POIs with the last ids
+         */
+        void update(const Corpus& corpus, std::vector< PoiId > const& changed, size_t const new_places);
 
-        void print() const;
+        /**
+         * Numbers the branches breadth-first again, reclaiming the slots that insert() and
+         * remove() left behind; save() and writePages() need it after such updates.
+         */
+        virtual void compact() = 0;
+
+        virtual void print() const = 0;
+
+        /**
+         * Prints the memory of the tree and of the user sets per level, and the bytes per node.
+         */
+        void printMemory(std::ostream &o) const;
+
+        /**
+         * @return the bytes of the flat tree and of the user sets; the pointer tree is not counted
+         */
+        size_t bytes() const;
+
+        /**
+         * Prints per level the area of the nodes, the overlap between the branches of a node
+         * and the dead space of a node that none of its branches covers, both as fractions of
+         * the area of the nodes.
+         */
+        void printQuality(std::ostream &o) const;
+
+        /**
+         * Writes the tree and its user aggregates as a page file for PagedIndex.
+         * @return 0 if successful; 1 if the file could not be written.
+         */
+        virtual int writePages(std::string const& filename, const Corpus& corpus) const = 0;
 
+        /**
+         * @param expanded : receives the number of nodes whose branches were scored
+         * @param options : with Index_Bound::Lazy, reheaps also counts the internal branches
+         * queued again instead of being expanded
+         */
+        template < Indexed_Variant variant >
         void query(popular::ResultSet &results, Point const& q, float const& a, uint32_t const k,
-                   double const& max_dist, uint32_t const& tot_users, uint32_t &prunes, uint32_t &reheaps);
+                   double const& max_dist, uint32_t const& tot_users, uint32_t &prunes, uint32_t &reheaps,
+                   uint32_t &expanded, SearchOptions const& options = SearchOptions()) const;
+
+        virtual uint32_t fanout() const = 0;
+        uint32_t depth() const { return flat.depth; }
+        uint32_t num_nodes() const { return flat.num_nodes; }
 
     protected:
+        Index() : built_( false ), updated_( false ), version_( 0 ) {}
 
-        void treeInsert(const ElemType a_min[NumDims], const ElemType a_max[NumDims], const DataType& a_dataId);
-        void updateUsers(const Checks& checkins);
-        void updateUsersRec(MyTree::Node* a_node, uint32_t* id, const Checks& checkins);
+        /**
+         * Reads the tree and the aggregates that follow the header of an index file.
+         * @return 0 if successful; 1 if the file is truncated or inconsistent.
+         */
+        virtual int read(RTFileStream &stream, IndexFileHeader const& header, const Corpus& corpus) = 0;
+
+        /**
+         * The best-first search of query(), bestFirst() over flat on a queue of type Queue
+         */
+        template < Indexed_Variant variant, typename Queue >
+        void search(popular::ResultSet &results, Point const& q, float const& a, uint32_t const k,
+                    double const& max_dist, uint32_t const& tot_users, uint32_t &prunes, uint32_t &reheaps,
+                    uint32_t &expanded, SearchOptions const& options) const;
 
         /**
          * Calculates the score of an MBR
-         * @param a_branch : the branch
+         * @param branch : the branch number in flat
          * @param q : the query point
          * @param a : the alpha parameter
          * @param k : the k parameter
          * @param max_dist : the maximum distance in the dataset
          * @param tot_users : the total number of users in the dataset
          * @param intermediateRes : the intermediate result set of POIs found so far
+         * @param bound : how the users below an internal branch are bounded
          * @return : the score of the MBR based on the inputs
          */
-        double scoreMBR( MyTree::Branch* a_branch, Point const q, float const a, uint32_t const k,
-                        double const max_dist, uint32_t const tot_users, IntermediateRes & intermediateRes );
+        double scoreMBR( uint32_t const branch, Point const q, float const a, uint32_t const k,
+                        double const max_dist, uint32_t const tot_users, IntermediateRes & intermediateRes,
+                        Index_Bound const bound ) const;
 
         /**
          * Calculates the contribution of an MBR/Point based on f(q,p,P)
-         * @param a_branch : the branch
+         * @param branch : the branch number in flat
          * @param q : the query point
          * @param a : the alpha parameter
          * @param k : the k parameter
          * @param max_dist : the maximum distance in the dataset
          * @param tot_users : the total number of users in the dataset
          * @param intermediateRes : the intermediate result set of POIs found so far
+         * @param bound : how the users below an internal branch are bounded
          * @return : the score of the MBR based on the inputs
          */
-        double contributionMBR( MyTree::Branch* a_branch, Point const q, float const a, uint32_t const k,
-                double const max_dist, uint32_t const tot_users, IntermediateRes & intermediateRes );
+        double contributionMBR( uint32_t const branch, Point const q, float const a, uint32_t const k,
+                double const max_dist, uint32_t const tot_users, IntermediateRes & intermediateRes,
+                Index_Bound const bound ) const;
+
+        /**
+         * Scores all the branches of the child node of an internal branch, as contributionMBR()
+         * would: the clamped distances are computed over the coordinate arrays in one vectorised
+         * loop, then the user gains in a second loop.
+         * @param scores : receives the score of each branch of the child node, in order
+         */
+        void scoreChildren( uint32_t const branch, Point const q, float const a, uint32_t const k,
+                double const max_dist, uint32_t const tot_users, IntermediateRes const& intermediateRes,
+                Index_Bound const bound, double *scores ) const;
+
+        /**
+         * @return the uncovered users below an internal branch, capped by the users of its
+         * largest POI
+         */
+        size_t maxPoiUsers( uint32_t const branch, Coverage const& coverage ) const;
 
         /**
          * Finds the minimum distance point from an MBR to the query point
-         * @param a_branch : the MBR
+         * @param branch : the branch number of the MBR in flat
          * @param q : the query point
          * @return : the minDist point
          */
-        Point minDistPoi(MyTree::Branch const& a_branch, Point const& q) const;
+        Point minDistPoi(uint32_t const branch, Point const& q) const;
 
         /**
-         * Checks if an MBR or POI can be pruned
-         * @param a_branch : the MBR or POI
-         * @param q : the query point
+         * Checks if an MBR or POI can be pruned, i.e., if all the users below it are covered
+         * already. It then contributes nothing if a == 0, and at most the distance part of
+         * its score otherwise.
+         * @param branch : the branch number of the MBR or POI in flat
          * @param coverage : the users coverage of the intermediate results
-         * @param pois : the POIs of the intermediate results
          * @return : true if MBR/POI can be pruned, false if not
          */
-        bool prune(MyTree::Branch const& a_branch, Point const& q,
-                std::vector< std::pair< uint32_t, Point > > const& pois, float const& a) const;
+        bool prune(uint32_t const branch, Coverage const& coverage) const;
+
+        /**
+         * @return the users below the branches [first, end), united in a bitmap of one bit per
+         * user of the corpus, which costs their sizes plus num_users() / 64 words; the
+         * aggregates of the internal ones must be current
+         */
+        UserSet usersBelow( uint32_t const first, uint32_t const end ) const;
+
+        /**
+         * Adds the users of the POIs to the aggregates of the paths to them, merging each set
+         * once with the users added to it, in time linear in their sizes.
+         * @return the number of POIs found in the index
+         */
+        size_t addUsers( std::vector< PoiId > const& pois );
+
+        /**
+         * Appends to path the branches from [first, end) down to the leaf branch of POI p,
+         * trying every branch whose MBR holds its point.
+         * @return false if p is not below them
+         */
+        bool pathTo( PoiId const p, uint32_t const first, uint32_t const end, std::vector< uint32_t > &path ) const;
+
+        /**
+         * Fills flat.max_users, provided that the children of every branch follow it.
+         */
+        void fillMaxUsers();
+
+        /**
+         * Calls f with the users below a branch: the aggregate of an internal branch, or the
+         * check-ins of the POI of a leaf branch, which are referenced in the corpus instead of
+         * being copied into the index.
+         */
+        template < typename F >
+        auto withUsers( uint32_t const branch, F && f ) const
+        {
+            return flat.is_leaf( branch ) ? f( corpus_.checkins( flat.first[ branch ] ) ) : f( users[ branch ] );
+        }
+
+        /**
+         * The branches [first, first + capacity) of flat that hold the branches of a node
+         */
+        struct Slot
+        {
+            uint32_t first;
+            uint32_t capacity;
+        };
+
+        /**
+         * @return a free slot of capacity branches, at the end of flat if none is left
+         */
+        Slot newSlot(uint32_t const capacity);
+
+        /**
+         * Empties the slots that no node uses any more; those of capacity branches are reused
+         * by newSlot().
+         */
+        void releaseSlots(std::vector< Slot > const& released, uint32_t const capacity);
+
+        FlatTree flat; /**< the layout searched by query() */
+        /**
+         * The users below each internal branch, by branch id. The leaves are the last level in
+         * breadth-first order, so the internal branches are exactly the ids below users.size().
+         */
+        std::vector< UserSet > users;
+        Corpus corpus_; /**< shares the storage of the corpus the index was built from, for the users of the leaves */
+        bool built_;
+        bool updated_; /**< whether insert() or remove() changed the index since it was flattened */
+        uint32_t version_; /**< the corpus version the index was built from */
+        std::vector< uint32_t > free_slots_; /**< the first branch of the slots no node uses, all of the same capacity */
+    };
+
+    /**
+     * An Index built from an RTree with MaxNodes branches per node. Only the fan-outs in
+     * Constants::RTREE_FANOUTS are instantiated.
+     */
+    template < int MaxNodes >
+    class BasicIndex : public Index
+    {
+    public:
+        using Tree = RTree< DataType, ElemType, NumDims, float, MaxNodes >;
+
+        BasicIndex() {}
+        ~BasicIndex() {}
+
+        void buildIndex(const Corpus& corpus, Index_Build const build = Index_Build::Insert) override;
+        int save(std::string const& filename, const Corpus& corpus) const override;
+        void clear() override;
+        void insert(const Corpus& corpus, PoiId const p) override;
+        bool remove(PoiId const p) override;
+        void compact() override;
+        void print() const override;
+        int writePages(std::string const& filename, const Corpus& corpus) const override;
+        uint32_t fanout() const override { return MaxNodes; }
+
+    protected:
+        int read(RTFileStream &stream, IndexFileHeader const& header, const Corpus& corpus) override;
+
+        void treeInsert(const ElemType a_min[NumDims], const ElemType a_max[NumDims], const DataType& a_dataId);
+        void updateUsers();
+
+        /**
+         * Numbers the branches breadth-first and copies the tree into flat.
+         * @param levels : receives the nodes of each level, leaves first
+         */
+        void flatten(std::vector< std::vector< typename Tree::Node* > > &levels);
+
+        /**
+         * Records the slot of every node of a compact tree, before its first update.
+         */
+        void trackSlots();
+
+        /**
+         * Copies the nodes that an update of rtree changed into flat, children first, and
+         * recomputes the aggregates of the branches whose child node changed.
+         */
+        void applyChanges(typename Tree::Changes const& changes);
 
-        MyTree rtree;
-        std::vector< std::vector< UserId > > users;
+        Tree rtree;
+        std::unordered_map< typename Tree::Node const*, Slot > slots_; /**< empty until the first update */
     };
 
 } // namespace popular
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file
+ * Implementation of the disk-resident R-tree search.
+ */
+
+#include "pagedIndex.hpp"
+#include "bestFirst.hpp"
+#include "../util/MBRPriorityQueue.hpp"
+
+#include <cstring> // std::memcmp()
+
+namespace popular
+{
+    template < Indexed_Variant variant >
+    int PagedIndex< variant >::open(std::string const& filename, Corpus const& corpus, size_t const num_frames)
+    {
+        if( pool.open( filename, num_frames ) == 1 ) { return 1; }
+
+        if( pool.read( 0, sizeof( header ), &header ) == 1
+         || std::memcmp( header.magic, Constants::PAGED_INDEX_MAGIC, sizeof( header.magic ) ) != 0
+         || header.version != Constants::PAGED_INDEX_VERSION
+         || header.header_size != sizeof( PagedIndexHeader )
+         || header.page_size != Constants::DISK_PAGE_SIZE
+         || header.max_nodes == 0 || header.max_nodes > Constants::RTREE_MAX_FANOUT
+         || header.file_size != pool.file_size() )
+        {
+            std::cerr << "Not a compatible page file (expected version " << Constants::PAGED_INDEX_VERSION
+                      << " with at most " << Constants::RTREE_MAX_FANOUT << " branches per node): " << filename << std::endl;
+            pool.close();
+            return 1;
+        }
+        if( header.num_places != corpus.num_places() || header.num_users != corpus.num_users()
+         || header.num_entries != corpus.num_entries() || header.fingerprint != corpus.fingerprint() )
+        {
+            std::cerr << "Page file was built from a different corpus: " << filename << std::endl;
+            pool.close();
+            return 1;
+        }
+
+        failed = false;
+        readNode( 0, root );
+        if( failed )
+        {
+            pool.close();
+            return 1;
+        }
+        pool.reset_counters();
+        return 0;
+    }
+
+    template < Indexed_Variant variant >
+    UserList PagedIndex< variant >::readUsers(PagedBranch const& branch)
+    {
+        scratch.resize( failed ? 0 : branch.num_users ); // nothing more is read after a failure
+        if( !failed && pool.read( branch.users_offset, branch.num_users * sizeof( UserId ), scratch.data() ) == 1 )
+        {
+            failed = true;
+            scratch.clear();
+        }
+        return UserList( scratch );
+    }
+
+    template < Indexed_Variant variant >
+    void PagedIndex< variant >::readNode(uint64_t const n, PagedNode &node)
+    {
+        if( failed || pool.read( node_offset( header, n ), node_size( header.max_nodes ), &node ) == 1 )
+        {
+            failed = true;
+            node.count = 0;
+            return;
+        }
+        // a corrupt node must not send a later read past the nodes, the POIs or the file
+        bool valid = n < header.num_nodes && node.count <= header.max_nodes;
+        for(uint32_t i = 0; valid && i < node.count; ++i)
+        {
+            PagedBranch const& branch = node.branches[i];
+            valid = branch.child < ( branch.is_leaf ? header.num_places : header.num_nodes )
+                 && branch.users_offset >= header.users_offset
+                 && branch.users_offset + uint64_t( branch.num_users ) * sizeof( UserId ) <= header.file_size;
+        }
+        if( !valid )
+        {
+            std::cerr << "Node " << n << " of the page file is corrupt." << std::endl;
+            failed = true;
+            node.count = 0;
+        }
+    }
+
+    /**
+     * The best-first search of Index::query() with the default options, on copies of the
+     * branch records.
+     */
+    template < Indexed_Variant variant >
+    int PagedIndex< variant >::query(popular::ResultSet &results, Point const& q, float const& a, uint32_t const k,
+            double const& max_dist, uint32_t const& tot_users, uint32_t &prunes, uint32_t &reheaps,
+            uint32_t &expanded)
+    {
+        using Queue = BasicMBRPriorityQueue< PagedBranch >;
+
+        // the accessor of bestFirst() over the pages
+        struct Tree
+        {
+            PagedIndex &index;
+            Point const& q;
+            float const a;
+            uint32_t const k;
+            double const max_dist;
+            uint32_t const tot_users;
+            PagedNode node;
+
+            void open( Queue &queue, IntermediateRes &intermediateRes )
+            {
+                for(uint32_t i = 0; i < index.root.count; ++i)
+                {
+                    PagedBranch const& branch = index.root.branches[i];
+                    queue.add_to_queue(branch, score(q, index.minDistPoi(branch, q), index.readUsers(branch), max_dist, k,
+                                                     tot_users, a, intermediateRes));
+                }
+            }
+
+            bool is_leaf( PagedBranch const& branch ) const { return branch.is_leaf; }
+            bool covered( PagedBranch const& branch, Coverage const& coverage ) { return coverage.covers( index.readUsers( branch ) ); }
+            bool rebound() const { return false; }
+            bool failed() const { return index.failed; }
+
+            double contribution( PagedBranch const& branch, IntermediateRes &intermediateRes )
+            {
+                return popular::contribution( q, index.minDistPoi( branch, q ), index.readUsers( branch ), max_dist, k,
+                                              tot_users, a, intermediateRes );
+            }
+
+            void expand( PagedBranch const& branch, Queue &queue, IntermediateRes &intermediateRes )
+            {
+                index.readNode( branch.child, node );
+                for(uint32_t i = 0; i < node.count; ++i)
+                {
+                    queue.add_to_queue(node.branches[i], contribution(node.branches[i], intermediateRes));
+                }
+            }
+
+            void accept( PagedBranch const& branch, ResultSet &results, IntermediateRes &intermediateRes )
+            {
+                Point const p( branch.min[0], branch.min[1] );
+                results.first.push_back( branch.child );
+                addIntermediate( intermediateRes, q, p, max_dist, index.readUsers( branch ) );
+            }
+        };
+
+        pool.reset_counters();
+        failed = false;
+        Tree tree{ *this, q, a, k, max_dist, tot_users, {} };
+        Queue queue;
+        bestFirst< variant >( tree, queue, results, a, k, tot_users, prunes, reheaps, expanded );
+        return failed ? 1 : 0;
+    }
+
+    template < Indexed_Variant variant >
+    Point PagedIndex< variant >::minDistPoi(PagedBranch const& branch, Point const& q) const
+    {
+        float const rx = std::min( std::max( q.first, branch.min[0] ), branch.max[0] );
+        float const ry = std::min( std::max( q.second, branch.min[1] ), branch.max[1] );
+        return std::make_pair(rx, ry);
+    }
+
+    template class PagedIndex< Indexed_Variant::Naive >;
+    template class PagedIndex< Indexed_Variant::ReHeap >;
+} // namespace popular
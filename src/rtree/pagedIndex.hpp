@@ -0,0 +1,152 @@
+/**
+ * @file
+ * A disk-resident layout of the R-tree index, searched through a buffer pool.
+ *
+ * Layout of a page file (native endianness, Constants::DISK_PAGE_SIZE pages):
+ *  - page 0        : PagedIndexHeader
+ *  - node pages    : PagedNode records of max_nodes branches in breadth-first order, packed
+ *                    so that no record straddles a page boundary
+ *  - user section  : the sorted users below each branch, as uint32 arrays by branch id
+ */
+
+#ifndef POPULAR_PAGED_INDEX
+#define POPULAR_PAGED_INDEX
+
+#include <string>
+#include <vector>
+#include <cstddef> // offsetof
+
+#include "../util/commons.hpp"
+#include "../util/bufferPool.hpp"
+#include "index.hpp"
+
+namespace popular
+{
+    /**
+     * The fixed-size header on the first page of a page file.
+     */
+    struct PagedIndexHeader
+    {
+        char magic[ 8 ]; /**< always Constants::PAGED_INDEX_MAGIC */
+        uint32_t version; /**< Constants::PAGED_INDEX_VERSION at the time of writing */
+        uint32_t header_size; /**< sizeof( PagedIndexHeader ), as a sanity check */
+        uint32_t page_size; /**< Constants::DISK_PAGE_SIZE at the time of writing */
+        uint32_t max_nodes; /**< the fan-out of the tree */
+        uint64_t file_size;
+        uint64_t num_nodes;
+        uint64_t num_branches;
+        uint64_t nodes_offset; /**< byte offset of the first node page */
+        uint64_t users_offset; /**< byte offset of the user section */
+        uint64_t num_places; /**< the corpus the index was built from, to detect a mismatch */
+        uint64_t num_users;
+        uint64_t num_entries;
+        uint64_t fingerprint; /**< Corpus::fingerprint() */
+    };
+
+    /**
+     * One branch of a node on disk.
+     */
+    struct PagedBranch
+    {
+        ElemType min[ NumDims ];
+        ElemType max[ NumDims ];
+        uint32_t child; /**< the node number of the child of an internal branch, or the POI id of a leaf branch */
+        uint32_t id; /**< the branch id, as in the in-memory index */
+        uint64_t users_offset; /**< byte offset of the users below the branch */
+        uint32_t num_users;
+        uint32_t is_leaf; /**< 1 if child is a POI id */
+    };
+
+    /**
+     * One node on disk; a node with level 0 is a leaf. Only the first max_nodes branches are
+     * stored, see node_size().
+     */
+    struct PagedNode
+    {
+        uint32_t count;
+        uint32_t level;
+        PagedBranch branches[ Constants::RTREE_MAX_FANOUT ];
+    };
+
+    /**
+     * @return the bytes of a node record in a page file with max_nodes branches per node
+     */
+    inline size_t node_size( uint32_t const max_nodes )
+    {
+        return offsetof( PagedNode, branches ) + max_nodes * sizeof( PagedBranch );
+    }
+
+    /**
+     * @return the byte offset of node number n in a page file
+     */
+    inline uint64_t node_offset( PagedIndexHeader const& header, uint64_t const n )
+    {
+        size_t const record = node_size( header.max_nodes );
+        size_t const per_page = Constants::DISK_PAGE_SIZE / record;
+        return header.nodes_offset + n / per_page * Constants::DISK_PAGE_SIZE + n % per_page * record;
+    }
+
+    /**
+     * Answers queries from a page file without loading the tree or its user aggregates:
+     * the best-first search of Index::query reads each node and each aggregate on demand
+     * through a fixed-size buffer pool.
+     */
+    template < Indexed_Variant variant >
+    class PagedIndex
+    {
+    public:
+        PagedIndex() : failed( false ) {}
+        ~PagedIndex() {}
+
+        /**
+         * Opens a page file written by Index::writePages() for the given corpus.
+         * @param num_frames : the number of pages kept in memory
+         * @return 0 if successful; 1 if the file could not be opened, is not a compatible
+         * page file or was built from a different corpus.
+         */
+        int open(std::string const& filename, Corpus const& corpus, size_t const num_frames);
+
+        bool is_open() const { return pool.is_open(); }
+
+        /**
+         * @return 0 if successful; 1 if a page could not be read, in which case the results are
+         * incomplete
+         */
+        int query(popular::ResultSet &results, Point const& q, float const& a, uint32_t const k,
+                  double const& max_dist, uint32_t const& tot_users, uint32_t &prunes, uint32_t &reheaps,
+                  uint32_t &expanded);
+
+        uint64_t page_hits() const { return pool.hits(); } /**< page hits of the last query */
+        uint64_t page_misses() const { return pool.misses(); } /**< page misses of the last query */
+        uint32_t depth() const { return root.level + 1; }
+        uint32_t num_nodes() const { return header.num_nodes; }
+
+    protected:
+        /**
+         * Reads the users below the branch into the scratch buffer; if that fails, sets failed
+         * and returns no users
+         */
+        UserList readUsers(PagedBranch const& branch);
+
+        /**
+         * Reads node number n; if that fails, or the node has more branches than the fan-out or a
+         * branch pointing past the nodes, the POIs or the file, sets failed and returns a node
+         * without branches
+         */
+        void readNode(uint64_t const n, PagedNode &node);
+
+        /**
+         * Finds the minimum distance point from a branch to the query point
+         */
+        Point minDistPoi(PagedBranch const& branch, Point const& q) const;
+
+        BufferPool pool;
+        PagedIndexHeader header;
+        PagedNode root;
+        std::vector< UserId > scratch; /**< the last aggregate read */
+        bool failed; /**< whether a read of the current query failed */
+    };
+
+} // namespace popular
+
+#endif
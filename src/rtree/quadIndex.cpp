@@ -0,0 +1,657 @@
+/**
+ * @file
+ * Implementation of the quadtree index.
+ */
+
+#include "quadIndex.hpp"
+
+#include <algorithm> // std::min(), std::max(), std::find(), std::sort()
+#include <cmath> // std::abs()
+#include <functional> // std::greater
+#include <iostream>
+#include <numeric> // std::iota()
+#include <unordered_map>
+
+namespace popular
+{
+    QuadIndex::QuadIndex(uint32_t const capacity) : capacity_( capacity ), grid_( 2 ), root_( 0 ), num_cells_( 0 )
+    {
+        while( ( grid_ + 1 ) * ( grid_ + 1 ) <= capacity_ ) { ++grid_; }
+    }
+
+    void QuadIndex::buildIndex(const Corpus& corpus, Index_Build const)
+    {
+        clear();
+        corpus_ = corpus;
+        leaf_of_.assign( corpus.num_places(), NO_CELL );
+        std::vector< PoiId > pois( corpus.num_places() );
+        std::iota( pois.begin(), pois.end(), PoiId( 0 ) );
+
+        double lo[ NumDims ] = { 0.0, 0.0 };
+        double hi[ NumDims ] = { 0.0, 0.0 };
+        if( !pois.empty() )
+        {
+            lo[ 0 ] = hi[ 0 ] = corpus_.xs[ pois[ 0 ] ];
+            lo[ 1 ] = hi[ 1 ] = corpus_.ys[ pois[ 0 ] ];
+        }
+        for( PoiId const p : pois )
+        {
+            lo[ 0 ] = std::min< double >( lo[ 0 ], corpus_.xs[ p ] );
+            hi[ 0 ] = std::max< double >( hi[ 0 ], corpus_.xs[ p ] );
+            lo[ 1 ] = std::min< double >( lo[ 1 ], corpus_.ys[ p ] );
+            hi[ 1 ] = std::max< double >( hi[ 1 ], corpus_.ys[ p ] );
+        }
+        root_ = split( pois, 0u, static_cast< uint32_t >( pois.size() ), lo, hi, 0u );
+        layout( false );
+        built_ = true;
+        version_ = corpus.version;
+    }
+
+    int QuadIndex::save(std::string const&, const Corpus&) const
+    {
+        std::cerr << "The quadtree index is built in memory only and cannot be saved." << std::endl;
+        return 1;
+    }
+
+    int QuadIndex::writePages(std::string const&, const Corpus&) const
+    {
+        std::cerr << "The quadtree index is built in memory only and cannot be written as pages." << std::endl;
+        return 1;
+    }
+
+    int QuadIndex::read(RTFileStream &, IndexFileHeader const&, const Corpus&)
+    {
+        return 1;
+    }
+
+    void QuadIndex::clear()
+    {
+        flat = FlatTree();
+        users.clear();
+        cells_.clear();
+        free_cells_.clear();
+        free_slots_.clear();
+        leaf_of_.clear();
+        root_ = 0;
+        num_cells_ = 0;
+        corpus_ = Corpus();
+        built_ = false;
+        updated_ = false;
+    }
+
+    /**
+     * The POI descends from the root to the leaf cell whose region holds it; the cells added
+     * on the way are on that path, so they are laid out with it.
+     */
+    void QuadIndex::insert(const Corpus& corpus, PoiId const p)
+    {
+        corpus_ = corpus;
+        version_ = corpus.version;
+        if( p >= leaf_of_.size() ) { leaf_of_.resize( p + 1, NO_CELL ); }
+        double const coords[ NumDims ] = { corpus_.xs[ p ], corpus_.ys[ p ] };
+        std::vector< uint32_t > changed;
+        std::vector< Slot > released;
+
+        if( cells_[ root_ ].size == 0 ) // the region of an empty tree starts at the point
+        {
+            for( int d = 0; d < NumDims; ++d ) { cells_[ root_ ].lo[ d ] = cells_[ root_ ].hi[ d ] = coords[ d ]; }
+        }
+        while( !inRegion( cells_[ root_ ], coords[ 0 ], coords[ 1 ] ) )
+        {
+            uint32_t const root = newCell();
+            Cell &cell = cells_[ root ];
+            Cell &old = cells_[ root_ ];
+            for( int d = 0; d < NumDims; ++d )
+            {
+                double extent = old.hi[ d ] - old.lo[ d ];
+                if( extent <= 0.0 ) { extent = std::abs( coords[ d ] - old.lo[ d ] ); }
+                cell.lo[ d ] = coords[ d ] < old.lo[ d ] ? old.hi[ d ] - grid_ * extent : old.lo[ d ];
+                cell.hi[ d ] = coords[ d ] < old.lo[ d ] ? old.hi[ d ] : old.lo[ d ] + grid_ * extent;
+            }
+            cell.size = old.size;
+            cell.children.push_back( root_ );
+            old.parent = root;
+            changed.push_back( root_ ); // the old root has no aggregate of its own yet
+            root_ = root;
+        }
+
+        uint32_t c = root_;
+        while( !cells_[ c ].children.empty() ) { c = childFor( c, coords[ 0 ], coords[ 1 ] ); }
+        cells_[ c ].pois.push_back( p );
+        leaf_of_[ p ] = c;
+        for( uint32_t a = c; a != NO_CELL; a = cells_[ a ].parent )
+        {
+            ++cells_[ a ].size;
+            changed.push_back( a );
+        }
+        if( cells_[ c ].pois.size() > capacity_ ) { splitLeaf( c, changed, released ); }
+        applyChanges( changed, released );
+    }
+
+    /**
+     * The cells left empty go first, then the topmost cell with at most capacity_ POIs below
+     * it becomes a leaf, so the leaves stay as full as in a build.
+     */
+    bool QuadIndex::remove(PoiId const p)
+    {
+        if( p >= leaf_of_.size() || leaf_of_[ p ] == NO_CELL ) { return false; }
+        uint32_t c = leaf_of_[ p ];
+        leaf_of_[ p ] = NO_CELL;
+        std::vector< PoiId > &pois = cells_[ c ].pois;
+        pois.erase( std::find( pois.begin(), pois.end(), p ) );
+        std::vector< uint32_t > changed;
+        std::vector< Slot > released;
+        for( uint32_t a = c; a != NO_CELL; a = cells_[ a ].parent )
+        {
+            --cells_[ a ].size;
+            changed.push_back( a );
+        }
+
+        while( c != root_ && cells_[ c ].size == 0 )
+        {
+            uint32_t const parent = cells_[ c ].parent;
+            std::vector< uint32_t > &children = cells_[ parent ].children;
+            children.erase( std::find( children.begin(), children.end(), c ) );
+            freeCell( c, released );
+            c = parent;
+        }
+        if( cells_[ c ].size == 0 ) { cells_[ c ].ordered = false; } // an empty tree is an empty leaf
+
+        uint32_t merge = NO_CELL;
+        for( uint32_t a = c; a != NO_CELL; a = cells_[ a ].parent )
+        {
+            if( !cells_[ a ].children.empty() && cells_[ a ].size <= capacity_ ) { merge = a; }
+        }
+        if( merge != NO_CELL )
+        {
+            std::vector< uint32_t > below;
+            below.swap( cells_[ merge ].children );
+            std::vector< PoiId > merged;
+            while( !below.empty() )
+            {
+                uint32_t const n = below.back();
+                below.pop_back();
+                merged.insert( merged.end(), cells_[ n ].pois.begin(), cells_[ n ].pois.end() );
+                below.insert( below.end(), cells_[ n ].children.begin(), cells_[ n ].children.end() );
+                freeCell( n, released );
+            }
+            for( PoiId const q : merged ) { leaf_of_[ q ] = merge; }
+            cells_[ merge ].pois.swap( merged );
+            cells_[ merge ].ordered = false;
+            c = merge;
+        }
+
+        for( uint32_t a = c; a != NO_CELL; )
+        {
+            uint32_t const parent = cells_[ a ].parent;
+            if( cells_[ a ].children.size() == 1 ) // a cell with one child is not a node of its own
+            {
+                uint32_t const child = cells_[ a ].children.front();
+                cells_[ child ].parent = parent;
+                if( parent == NO_CELL ) { root_ = child; }
+                else { replaceChild( parent, a, child ); }
+                freeCell( a, released );
+            }
+            a = parent;
+        }
+        applyChanges( changed, released );
+        return true;
+    }
+
+    void QuadIndex::compact()
+    {
+        if( !updated_ ) { return; }
+        layout( true );
+    }
+
+    void QuadIndex::print() const
+    {
+        std::cout << "QUADTREE : capacity = " << capacity_ << "  grid = " << grid_ << " x " << grid_
+                  << "  depth = " << flat.depth << "  nodes = " << flat.num_nodes << std::endl;
+
+        std::cout << "  USERS : " << std::endl;
+        for(uint32_t i = 0; i < users.size(); i++)
+        {
+            std::cout << "   mbr id = " << i << "  users.size = " << users[i].size()
+                      << "  bytes = " << users[i].bytes() << std::endl;
+        }
+    }
+
+    /**
+     * The POIs are distributed over the grid of the region by a counting sort. POIs too close
+     * to be told apart within Constants::QUADTREE_MAX_DEPTH subdivisions are split in order.
+     */
+    uint32_t QuadIndex::split( std::vector< PoiId > &pois, uint32_t const begin, uint32_t const end,
+                               double const lo[ NumDims ], double const hi[ NumDims ], uint32_t const depth )
+    {
+        uint32_t const n = end - begin;
+        std::vector< uint32_t > children;
+        bool const ordered = n > capacity_ && depth >= Constants::QUADTREE_MAX_DEPTH;
+        if( ordered )
+        {
+            uint32_t const parts = std::min( grid_ * grid_, ( n + capacity_ - 1 ) / capacity_ );
+            for( uint32_t i = 0; i < parts; ++i )
+            {
+                uint32_t const child = split( pois, begin + static_cast< uint64_t >( n ) * i / parts,
+                                              begin + static_cast< uint64_t >( n ) * ( i + 1 ) / parts, lo, hi, depth );
+                children.push_back( child );
+            }
+        }
+        else if( n > capacity_ )
+        {
+            uint32_t const num_cells = grid_ * grid_;
+            auto const cell_of = [ & ]( PoiId const p ) { return gridCell( lo, hi, corpus_.xs[ p ], corpus_.ys[ p ] ); };
+
+            std::vector< uint32_t > start( num_cells + 1, 0u );
+            for( uint32_t i = begin; i < end; ++i ) { ++start[ cell_of( pois[ i ] ) + 1 ]; }
+            for( uint32_t c = 0; c < num_cells; ++c ) { start[ c + 1 ] += start[ c ]; }
+            std::vector< PoiId > sorted( n );
+            std::vector< uint32_t > next( start.begin(), start.end() - 1 );
+            for( uint32_t i = begin; i < end; ++i ) { sorted[ next[ cell_of( pois[ i ] ) ]++ ] = pois[ i ]; }
+            std::copy( sorted.begin(), sorted.end(), pois.begin() + begin );
+
+            for( uint32_t c = 0; c < num_cells; ++c )
+            {
+                if( start[ c ] == start[ c + 1 ] ) { continue; }
+                double cell_lo[ NumDims ] = { lo[ 0 ], lo[ 1 ] };
+                double cell_hi[ NumDims ] = { hi[ 0 ], hi[ 1 ] };
+                subRegion( cell_lo, cell_hi, c );
+                // a region whose POIs all fall into one cell is not a node of its own
+                if( start[ c + 1 ] - start[ c ] == n ) { return split( pois, begin, end, cell_lo, cell_hi, depth + 1 ); }
+                uint32_t const child = split( pois, begin + start[ c ], begin + start[ c + 1 ], cell_lo, cell_hi, depth + 1 );
+                children.push_back( child );
+            }
+        }
+
+        uint32_t const c = newCell();
+        Cell &cell = cells_[ c ];
+        for( int d = 0; d < NumDims; ++d )
+        {
+            cell.lo[ d ] = lo[ d ];
+            cell.hi[ d ] = hi[ d ];
+        }
+        cell.size = n;
+        cell.ordered = ordered;
+        cell.children.swap( children );
+        if( cell.children.empty() )
+        {
+            cell.pois.assign( pois.begin() + begin, pois.begin() + end );
+            for( PoiId const p : cell.pois ) { leaf_of_[ p ] = c; }
+        }
+        for( uint32_t const child : cell.children ) { cells_[ child ].parent = c; }
+        bound( c );
+        return c;
+    }
+
+    /**
+     * A node either has only cells or only POIs as branches. Numbering the nodes over cells
+     * first keeps the leaf branches last, as in the R-tree, though the leaf cells are at
+     * different depths; the children of a branch still follow it.
+     */
+    void QuadIndex::layout( bool const reuse )
+    {
+        std::vector< uint32_t > nodes{ root_ };
+        std::vector< uint32_t > level( cells_.size(), 0u );
+        std::vector< uint32_t > inner, leaves;
+        for( size_t n = 0; n < nodes.size(); ++n )
+        {
+            uint32_t const c = nodes[ n ];
+            ( cells_[ c ].children.empty() ? leaves : inner ).push_back( c );
+            for( uint32_t const child : cells_[ c ].children )
+            {
+                level[ child ] = level[ c ] + 1;
+                nodes.push_back( child );
+            }
+        }
+
+        uint32_t size = 0;
+        for( uint32_t const c : inner ) { cells_[ c ].slot = Slot{ size, numBranches( cells_[ c ] ) }; size += cells_[ c ].slot.capacity; }
+        uint32_t const num_internal = size;
+        for( uint32_t const c : leaves ) { cells_[ c ].slot = Slot{ size, numBranches( cells_[ c ] ) }; size += cells_[ c ].slot.capacity; }
+
+        flat = FlatTree();
+        for( int d = 0; d < NumDims; ++d )
+        {
+            flat.min[ d ].resize( size );
+            flat.max[ d ].resize( size );
+        }
+        flat.first.resize( size );
+        flat.count.resize( size );
+        flat.root_first = cells_[ root_ ].slot.first;
+        flat.root_count = numBranches( cells_[ root_ ] );
+        flat.num_internal = num_internal;
+        flat.num_nodes = static_cast< uint32_t >( nodes.size() );
+        flat.depth = level[ nodes.back() ] + 1;
+        free_slots_.clear();
+        updated_ = false;
+
+        std::vector< UserSet > old_users;
+        old_users.swap( users );
+        users.resize( num_internal );
+        for( uint32_t const c : nodes )
+        {
+            Cell const& cell = cells_[ c ];
+            for( uint32_t i = 0; i < numBranches( cell ); ++i )
+            {
+                uint32_t const b = cell.slot.first + i;
+                if( cell.children.empty() )
+                {
+                    PoiId const p = cell.pois[ i ];
+                    flat.min[ 0 ][ b ] = flat.max[ 0 ][ b ] = static_cast< ElemType >( corpus_.xs[ p ] );
+                    flat.min[ 1 ][ b ] = flat.max[ 1 ][ b ] = static_cast< ElemType >( corpus_.ys[ p ] );
+                    flat.first[ b ] = p;
+                    flat.count[ b ] = 0u;
+                    continue;
+                }
+                Cell &child = cells_[ cell.children[ i ] ];
+                for( int d = 0; d < NumDims; ++d )
+                {
+                    flat.min[ d ][ b ] = child.min[ d ];
+                    flat.max[ d ][ b ] = child.max[ d ];
+                }
+                flat.first[ b ] = child.slot.first;
+                flat.count[ b ] = static_cast< uint8_t >( child.slot.capacity );
+                if( reuse ) { users[ b ] = std::move( old_users[ child.branch ] ); }
+                child.branch = b;
+            }
+        }
+        fillMaxUsers();
+        if( reuse ) { return; }
+
+        // the aggregates of a level only read those of the level below, as in BasicIndex::updateUsers()
+        for( size_t end = inner.size(); end > 0; )
+        {
+            size_t begin = end;
+            while( begin > 0 && level[ inner[ begin - 1 ] ] == level[ inner[ end - 1 ] ] ) { --begin; }
+            #pragma omp parallel for schedule(dynamic, 16)
+            for( size_t n = begin; n < end; ++n )
+            {
+                Slot const slot = cells_[ inner[ n ] ].slot;
+                for( uint32_t b = slot.first; b < slot.first + slot.capacity; ++b )
+                {
+                    users[ b ] = usersBelow( flat.first[ b ], flat.first[ b ] + flat.count[ b ] );
+                }
+            }
+            end = begin;
+        }
+    }
+
+    /**
+     * The children of a cell lie in distinct cells of its grid, each within its grid cell,
+     * unless the cell splits its POIs in order, when any child will do. A child narrower than
+     * its grid cell, because its POIs all fell into one cell of a split, may not hold the point:
+     * the grid cell is then narrowed down to where they part, and the cell put over the child
+     * there gets a leaf cell for the point on the next step.
+     */
+    uint32_t QuadIndex::childFor( uint32_t const c, double const x, double const y )
+    {
+        std::vector< uint32_t > const& children = cells_[ c ].children;
+        if( cells_[ c ].ordered )
+        {
+            return *std::min_element( children.begin(), children.end(), [ this ]( uint32_t const a, uint32_t const b ) {
+                return cells_[ a ].size < cells_[ b ].size;
+            } );
+        }
+
+        double lo[ NumDims ] = { cells_[ c ].lo[ 0 ], cells_[ c ].lo[ 1 ] };
+        double hi[ NumDims ] = { cells_[ c ].hi[ 0 ], cells_[ c ].hi[ 1 ] };
+        auto const center_of = [ this, &lo, &hi ]( uint32_t const n ) {
+            Cell const& cell = cells_[ n ];
+            return gridCell( lo, hi, ( cell.lo[ 0 ] + cell.hi[ 0 ] ) / 2, ( cell.lo[ 1 ] + cell.hi[ 1 ] ) / 2 );
+        };
+        uint32_t const g = gridCell( lo, hi, x, y );
+        auto const it = std::find_if( children.begin(), children.end(), [ & ]( uint32_t const n ) { return center_of( n ) == g; } );
+        subRegion( lo, hi, g );
+        if( it == children.end() )
+        {
+            uint32_t const leaf = newCell();
+            for( int d = 0; d < NumDims; ++d )
+            {
+                cells_[ leaf ].lo[ d ] = lo[ d ];
+                cells_[ leaf ].hi[ d ] = hi[ d ];
+            }
+            cells_[ leaf ].parent = c;
+            cells_[ c ].children.push_back( leaf );
+            return leaf;
+        }
+
+        uint32_t const child = *it;
+        if( inRegion( cells_[ child ], x, y ) ) { return child; }
+        for( uint32_t depth = 0; depth < Constants::QUADTREE_MAX_DEPTH; ++depth )
+        {
+            uint32_t const to = gridCell( lo, hi, x, y );
+            if( center_of( child ) != to )
+            {
+                uint32_t const cell = newCell();
+                for( int d = 0; d < NumDims; ++d )
+                {
+                    cells_[ cell ].lo[ d ] = lo[ d ];
+                    cells_[ cell ].hi[ d ] = hi[ d ];
+                }
+                cells_[ cell ].parent = c;
+                cells_[ cell ].size = cells_[ child ].size;
+                cells_[ cell ].children.push_back( child );
+                cells_[ child ].parent = cell;
+                replaceChild( c, child, cell );
+                return cell;
+            }
+            subRegion( lo, hi, to );
+        }
+        return child; // too close to the POIs of the child to be told apart
+    }
+
+    void QuadIndex::splitLeaf( uint32_t const c, std::vector< uint32_t > &changed, std::vector< Slot > &released )
+    {
+        std::vector< PoiId > pois;
+        pois.swap( cells_[ c ].pois );
+        double const lo[ NumDims ] = { cells_[ c ].lo[ 0 ], cells_[ c ].lo[ 1 ] };
+        double const hi[ NumDims ] = { cells_[ c ].hi[ 0 ], cells_[ c ].hi[ 1 ] };
+        uint32_t const parent = cells_[ c ].parent;
+        uint32_t depth = 0;
+        for( uint32_t a = parent; a != NO_CELL; a = cells_[ a ].parent ) { ++depth; }
+
+        uint32_t const cell = split( pois, 0u, static_cast< uint32_t >( pois.size() ), lo, hi, depth );
+        cells_[ cell ].parent = parent;
+        if( parent == NO_CELL ) { root_ = cell; }
+        else { replaceChild( parent, c, cell ); }
+        freeCell( c, released );
+
+        for( std::vector< uint32_t > added{ cell }; !added.empty(); )
+        {
+            uint32_t const n = added.back();
+            added.pop_back();
+            changed.push_back( n );
+            added.insert( added.end(), cells_[ n ].children.begin(), cells_[ n ].children.end() );
+        }
+    }
+
+    /**
+     * As in BasicIndex::applyChanges(), the aggregates of the branches whose child did not
+     * change are taken out before any slot is written, a changed child is written before its
+     * parent and the slots that a node outgrew are only reused by later updates. Every slot
+     * written holds capacity_ branches, enough for a leaf cell and for a grid.
+     */
+    void QuadIndex::applyChanges( std::vector< uint32_t > &changed, std::vector< Slot > &released )
+    {
+        users.resize( flat.size() ); // a compact layout only holds the aggregates of its internal branches
+        std::sort( changed.begin(), changed.end() );
+        changed.erase( std::unique( changed.begin(), changed.end() ), changed.end() );
+        auto const was_changed = [ &changed ]( uint32_t const c ) { return std::binary_search( changed.begin(), changed.end(), c ); };
+
+        std::vector< std::pair< uint32_t, uint32_t > > order; // depth and cell, deepest first
+        for( uint32_t const c : changed )
+        {
+            if( !cells_[ c ].alive ) { continue; }
+            uint32_t depth = 0;
+            for( uint32_t a = cells_[ c ].parent; a != NO_CELL; a = cells_[ a ].parent ) { ++depth; }
+            order.emplace_back( depth, c );
+        }
+        std::sort( order.begin(), order.end(), std::greater< std::pair< uint32_t, uint32_t > >() );
+
+        std::unordered_map< uint32_t, std::pair< UserSet, uint32_t > > kept; // by child cell
+        for( auto const& entry : order )
+        {
+            for( uint32_t const child : cells_[ entry.second ].children )
+            {
+                if( was_changed( child ) ) { continue; }
+                uint32_t const b = cells_[ child ].branch;
+                kept.emplace( child, std::make_pair( std::move( users[ b ] ), flat.max_users[ b ] ) );
+            }
+        }
+
+        for( auto const& entry : order )
+        {
+            uint32_t const c = entry.second;
+            bound( c );
+            Cell &cell = cells_[ c ];
+            uint32_t const count = numBranches( cell );
+            if( cell.slot.capacity < count )
+            {
+                if( cell.slot.capacity > 0 ) { released.push_back( cell.slot ); }
+                cell.slot = newSlot( capacity_ );
+            }
+
+            for( uint32_t i = 0; i < count; ++i )
+            {
+                uint32_t const b = cell.slot.first + i;
+                if( cell.children.empty() )
+                {
+                    PoiId const p = cell.pois[ i ];
+                    flat.min[ 0 ][ b ] = flat.max[ 0 ][ b ] = static_cast< ElemType >( corpus_.xs[ p ] );
+                    flat.min[ 1 ][ b ] = flat.max[ 1 ][ b ] = static_cast< ElemType >( corpus_.ys[ p ] );
+                    flat.first[ b ] = p;
+                    flat.count[ b ] = 0u;
+                    flat.max_users[ b ] = static_cast< uint32_t >( corpus_.checkins( p ).size() );
+                    continue;
+                }
+
+                Cell &child = cells_[ cell.children[ i ] ];
+                uint32_t const first = child.slot.first;
+                uint32_t const end = first + numBranches( child );
+                child.branch = b;
+                for( int d = 0; d < NumDims; ++d )
+                {
+                    flat.min[ d ][ b ] = child.min[ d ];
+                    flat.max[ d ][ b ] = child.max[ d ];
+                }
+                flat.first[ b ] = first;
+                flat.count[ b ] = static_cast< uint8_t >( end - first );
+                auto const kept_users = kept.find( cell.children[ i ] );
+                if( kept_users != kept.end() )
+                {
+                    users[ b ] = std::move( kept_users->second.first );
+                    flat.max_users[ b ] = kept_users->second.second;
+                    continue;
+                }
+                users[ b ] = usersBelow( first, end );
+                flat.max_users[ b ] = first == end ? 0u : *std::max_element( flat.max_users.begin() + first, flat.max_users.begin() + end );
+            }
+        }
+        releaseSlots( released, capacity_ );
+
+        flat.root_first = cells_[ root_ ].slot.first;
+        flat.root_count = numBranches( cells_[ root_ ] );
+        flat.depth = cells_[ root_ ].height + 1;
+        flat.num_nodes = num_cells_;
+        updated_ = true;
+    }
+
+    uint32_t QuadIndex::gridCell( double const lo[ NumDims ], double const hi[ NumDims ], double const x, double const y ) const
+    {
+        double const coords[ NumDims ] = { x, y };
+        uint32_t c = 0;
+        for( int d = 0; d < NumDims; ++d )
+        {
+            double const extent = hi[ d ] - lo[ d ];
+            double const at = extent > 0.0 ? ( coords[ d ] - lo[ d ] ) / extent * grid_ : 0.0;
+            c = c * grid_ + static_cast< uint32_t >( std::min( std::max( at, 0.0 ), grid_ - 1.0 ) );
+        }
+        return c;
+    }
+
+    void QuadIndex::subRegion( double lo[ NumDims ], double hi[ NumDims ], uint32_t const g ) const
+    {
+        uint32_t const at[ NumDims ] = { g / grid_, g % grid_ };
+        for( int d = 0; d < NumDims; ++d )
+        {
+            double const width = ( hi[ d ] - lo[ d ] ) / grid_;
+            double const from = lo[ d ];
+            lo[ d ] = from + width * at[ d ];
+            hi[ d ] = at[ d ] + 1 == grid_ ? hi[ d ] : from + width * ( at[ d ] + 1 );
+        }
+    }
+
+    bool QuadIndex::inRegion( Cell const& cell, double const x, double const y ) const
+    {
+        double const coords[ NumDims ] = { x, y };
+        for( int d = 0; d < NumDims; ++d )
+        {
+            double const slack = ( cell.hi[ d ] - cell.lo[ d ] ) * 1e-9; // the grid cells are rounded
+            if( coords[ d ] < cell.lo[ d ] - slack || coords[ d ] > cell.hi[ d ] + slack ) { return false; }
+        }
+        return true;
+    }
+
+    void QuadIndex::bound( uint32_t const c )
+    {
+        Cell &cell = cells_[ c ];
+        bool const empty = cell.pois.empty() && cell.children.empty();
+        for( int d = 0; d < NumDims; ++d )
+        {
+            cell.min[ d ] = empty ? 0.0f : std::numeric_limits< ElemType >::max();
+            cell.max[ d ] = empty ? 0.0f : std::numeric_limits< ElemType >::lowest();
+        }
+        cell.height = 0;
+        for( PoiId const p : cell.pois )
+        {
+            ElemType const coords[ NumDims ] = { static_cast< ElemType >( corpus_.xs[ p ] ),
+                                                 static_cast< ElemType >( corpus_.ys[ p ] ) };
+            for( int d = 0; d < NumDims; ++d )
+            {
+                cell.min[ d ] = std::min( cell.min[ d ], coords[ d ] );
+                cell.max[ d ] = std::max( cell.max[ d ], coords[ d ] );
+            }
+        }
+        for( uint32_t const child : cell.children )
+        {
+            for( int d = 0; d < NumDims; ++d )
+            {
+                cell.min[ d ] = std::min( cell.min[ d ], cells_[ child ].min[ d ] );
+                cell.max[ d ] = std::max( cell.max[ d ], cells_[ child ].max[ d ] );
+            }
+            cell.height = std::max( cell.height, cells_[ child ].height + 1 );
+        }
+    }
+
+    uint32_t QuadIndex::newCell()
+    {
+        uint32_t c = static_cast< uint32_t >( cells_.size() );
+        if( free_cells_.empty() ) { cells_.emplace_back(); }
+        else
+        {
+            c = free_cells_.back();
+            free_cells_.pop_back();
+        }
+        cells_[ c ] = Cell{ { 0.0, 0.0 }, { 0.0, 0.0 }, { 0.0f, 0.0f }, { 0.0f, 0.0f },
+                            NO_CELL, 0u, 0u, Slot{ 0u, 0u }, 0u, false, true, {}, {} };
+        ++num_cells_;
+        return c;
+    }
+
+    void QuadIndex::freeCell( uint32_t const c, std::vector< Slot > &released )
+    {
+        Cell &cell = cells_[ c ];
+        if( cell.slot.capacity > 0 ) { released.push_back( cell.slot ); }
+        cell = Cell{ { 0.0, 0.0 }, { 0.0, 0.0 }, { 0.0f, 0.0f }, { 0.0f, 0.0f },
+                     NO_CELL, 0u, 0u, Slot{ 0u, 0u }, 0u, false, false, {}, {} };
+        free_cells_.push_back( c );
+        --num_cells_;
+    }
+
+    void QuadIndex::replaceChild( uint32_t const parent, uint32_t const from, uint32_t const to )
+    {
+        std::vector< uint32_t > &children = cells_[ parent ].children;
+        *std::find( children.begin(), children.end(), from ) = to;
+    }
+
+} // namespace popular
@@ -0,0 +1,186 @@
+/**
+ * @file
+ * Defining of a quadtree index, a hierarchy of uniform grids over the POIs searched like the
+ * R-tree index.
+ */
+
+#ifndef POPULAR_QUAD_INDEX
+#define POPULAR_QUAD_INDEX
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "index.hpp"
+
+namespace popular
+{
+    /**
+     * A bucket quadtree over the POIs of a corpus with the users below each cell. A cell with
+     * more POIs than the capacity is split into a grid of g x g equal cells, where g * g is the
+     * largest square not above the capacity, so a capacity of 4 gives a plain quadtree and a
+     * capacity of 64 a grid of 8 x 8 cells per level. Only the cells that hold POIs become
+     * branches, with the tight bounds of their POIs as MBR; a cell whose POIs all fall into one
+     * of its cells is not a node of its own.
+     *
+     * The cells are laid out in the same flat tree as the R-tree, so Index::query() and its
+     * bounds are shared; unlike the R-tree, the shape of the tree only depends on where the POIs
+     * are, and dense areas end in deeper leaves.
+     */
+    class QuadIndex : public Index
+    {
+    public:
+        /**
+         * @param capacity : the most POIs of a leaf cell, and the most cells a cell is split into;
+         * at most Constants::RTREE_MAX_FANOUT
+         */
+        explicit QuadIndex(uint32_t const capacity);
+        ~QuadIndex() {}
+
+        /**
+         * Builds the quadtree over all the POIs of the corpus; the build method of the R-tree
+         * does not apply and is ignored.
+         */
+        void buildIndex(const Corpus& corpus, Index_Build const build = Index_Build::Insert) override;
+
+        /**
+         * The quadtree is only built in memory, so this fails.
+         * @return 1
+         */
+        int save(std::string const& filename, const Corpus& corpus) const override;
+        void clear() override;
+
+        /**
+         * The updates only change the leaf cell of the POI, found through leaf_of_, and its
+         * ancestors: a leaf cell over the capacity is split as in a build, a cell left with at
+         * most capacity POIs below it becomes a leaf and a cell left with one child is replaced
+         * by it. A POI outside the region of the root grows it g times per side. The changed
+         * cells are copied into slots of flat, as in BasicIndex. The cells can then differ from
+         * those of a build over the same POIs until the quadtree is built again.
+         */
+        void insert(const Corpus& corpus, PoiId const p) override;
+        bool remove(PoiId const p) override;
+
+        /**
+         * Lays the cells out afresh, moving the aggregates along with their branches.
+         */
+        void compact() override;
+        void print() const override;
+
+        /**
+         * The page file layout is that of the R-tree, so this fails.
+         * @return 1
+         */
+        int writePages(std::string const& filename, const Corpus& corpus) const override;
+        uint32_t fanout() const override { return capacity_; }
+
+    protected:
+        int read(RTFileStream &stream, IndexFileHeader const& header, const Corpus& corpus) override;
+
+    private:
+        static constexpr uint32_t NO_CELL = std::numeric_limits< uint32_t >::max();
+
+        /**
+         * A cell of the quadtree: the region it divides into its grid and the tight bounds of
+         * the POIs below it. A leaf cell has no children; its POIs are its branches.
+         */
+        struct Cell
+        {
+            double lo[ NumDims ];
+            double hi[ NumDims ];
+            ElemType min[ NumDims ];
+            ElemType max[ NumDims ];
+            uint32_t parent; /**< NO_CELL for the root */
+            uint32_t size; /**< the POIs below the cell */
+            uint32_t height; /**< 0 for a leaf cell */
+            Slot slot; /**< where flat holds its node; no branches before it is laid out */
+            uint32_t branch; /**< its branch in the node of its parent */
+            bool ordered; /**< whether its children split its POIs in order, as they are too close to be told apart */
+            bool alive;
+            std::vector< uint32_t > children; /**< indices into cells_ */
+            std::vector< PoiId > pois; /**< the POIs of a leaf cell */
+        };
+
+        /**
+         * Splits the POIs [begin, end) of pois, which lie in the region [lo, hi], into new cells
+         * until every leaf cell holds at most capacity_ POIs, reordering them by cell.
+         * @param depth : the subdivisions of the region so far
+         * @return the index of the cell that holds them, without a parent
+         */
+        uint32_t split( std::vector< PoiId > &pois, uint32_t const begin, uint32_t const end,
+                        double const lo[ NumDims ], double const hi[ NumDims ], uint32_t const depth );
+
+        /**
+         * Numbers the branches of the cells over cells breadth-first, then those of the leaf
+         * cells, copies them into flat and fills the aggregates bottom-up.
+         * @param reuse : whether the aggregates of the internal branches are moved from their
+         * branches in the current flat instead of being computed
+         */
+        void layout( bool const reuse );
+
+        /**
+         * @return the child of the internal cell c whose region the point falls into; a leaf
+         * cell is added if there is none, and a cell is put over a child whose region is
+         * narrower than its grid cell if the point lies outside it
+         */
+        uint32_t childFor( uint32_t const c, double const x, double const y );
+
+        /**
+         * Replaces the leaf cell c, which holds more than capacity_ POIs, by the cells split
+         * from them.
+         */
+        void splitLeaf( uint32_t const c, std::vector< uint32_t > &changed, std::vector< Slot > &released );
+
+        /**
+         * Copies the changed cells into flat, children first, and recomputes their bounds and
+         * the aggregates of the branches whose child changed.
+         */
+        void applyChanges( std::vector< uint32_t > &changed, std::vector< Slot > &released );
+
+        /**
+         * @return the cell of the grid of the region [lo, hi] that the point falls into;
+         * a point outside the region falls into the nearest one
+         */
+        uint32_t gridCell( double const lo[ NumDims ], double const hi[ NumDims ], double const x, double const y ) const;
+
+        /**
+         * Narrows the region [lo, hi] to its grid cell g.
+         */
+        void subRegion( double lo[ NumDims ], double hi[ NumDims ], uint32_t const g ) const;
+
+        /**
+         * @return whether the point lies in the region of the cell, up to rounding
+         */
+        bool inRegion( Cell const& cell, double const x, double const y ) const;
+
+        /**
+         * Sets the tight bounds and the height of the cell from its POIs or children.
+         */
+        void bound( uint32_t const c );
+
+        static uint32_t numBranches( Cell const& cell )
+        {
+            return static_cast< uint32_t >( cell.children.empty() ? cell.pois.size() : cell.children.size() );
+        }
+
+        uint32_t newCell();
+
+        /**
+         * Frees the cell; the slot of its node is added to released.
+         */
+        void freeCell( uint32_t const c, std::vector< Slot > &released );
+
+        void replaceChild( uint32_t const parent, uint32_t const from, uint32_t const to );
+
+        uint32_t capacity_;
+        uint32_t grid_; /**< the cells per side of a split */
+        std::vector< Cell > cells_;
+        std::vector< uint32_t > free_cells_;
+        uint32_t root_;
+        uint32_t num_cells_; /**< the cells alive */
+        std::vector< uint32_t > leaf_of_; /**< the leaf cell of each POI, by POI id; NO_CELL for a POI not in the index */
+    };
+
+} // namespace popular
+
+#endif
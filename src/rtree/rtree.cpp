@@ -6,29 +6,58 @@
 #include "rtree.hpp"
 #include "../util/commons.hpp"
 #include "../util/constants.hpp"
-#include "index_impl.hpp"
 
 #include <algorithm> // for_each, prev_permutation
+#include <stdexcept> // std::runtime_error
 
 namespace popular
 {
-    template < Indexed_Variant variant >
-    void Indexed< variant >::preprocess(const popular::Point &/*q*/, uint32_t /*k*/, float const &/*a*/)
-    {
-        index.buildIndex(corpus_.places, corpus_.checkins);
-    }
-
     template < Indexed_Variant variant >
     void Indexed< variant >::query(uint32_t k, Point const& q, float const& a, ResultSet &results,
             double &z_from_lp, uint32_t &prunes, uint32_t &reheaps)
     {
         z_from_lp = prunes = reheaps = 0;
 
-        index.query(results, q, a, k, corpus_.max_distance, corpus_.users.size(), prunes, reheaps);
+        if( paged.is_open() )
+        {
+            if( paged.query(results, q, a, k, corpus_.max_distance, corpus_.num_users(), prunes, reheaps, expanded) == 1 )
+            {
+                // Algorithm::query() has no status, so the failure ends the run in main()
+                throw std::runtime_error( "the page file could not be read" );
+            }
+        }
+        else
+        {
+            index->query< variant >(results, q, a, k, corpus_.max_distance, corpus_.num_users(), prunes, reheaps, expanded, options);
+        }
 
         results.second = main_scoring{ user_similarity{ corpus_ }, a, k }( q, results.first );
     }
 
+    template < Indexed_Variant variant >
+    void Indexed< variant >::fill_stats(Stats &stats) const
+    {
+        if( paged.is_open() )
+        {
+            stats.page_hits = paged.page_hits();
+            stats.page_misses = paged.page_misses();
+            stats.tree_depth = paged.depth();
+            stats.tree_nodes = paged.num_nodes();
+        }
+        else
+        {
+            stats.tree_depth = index->depth();
+            stats.tree_nodes = index->num_nodes();
+        }
+        stats.nodes_expanded = expanded;
+    }
+
+    template < Indexed_Variant variant >
+    int Indexed< variant >::openPages(std::string const& filename, size_t const num_frames)
+    {
+        return paged.open(filename, corpus_, num_frames);
+    }
+
     template class Indexed< Indexed_Variant::Naive >;
     template class Indexed< Indexed_Variant::ReHeap >;
 } // namespace popular
\ No newline at end of file
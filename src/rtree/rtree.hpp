@@ -7,9 +7,12 @@
 #ifndef POPULAR_RTREE
 #define POPULAR_RTREE
 
+#include <memory> // std::shared_ptr
+
 #include "../algorithm/algorithm.hpp"
 #include "../util/constants.hpp"
 #include "index.hpp"
+#include "pagedIndex.hpp"
 
 namespace popular
 {
@@ -17,16 +20,32 @@ namespace popular
     class Indexed : public Algorithm
     {
     public:
-        Indexed() {} /**< Empty constructor */
         ~Indexed() {} /**< Empty destructor */
 
-        Indexed(Corpus const &corpus): Algorithm(corpus) {}
+        /**
+         * @param index : the index of the corpus, shared by all Indexed algorithms; may be empty
+         * if the queries are answered from a page file (see openPages())
+         * @param options : how the index is searched; the page file is always searched with the
+         * default options, as it does not store the largest POI below each branch
+         */
+        Indexed(Corpus const &corpus, std::shared_ptr< Index const > index, SearchOptions const& options = SearchOptions())
+            : Algorithm(corpus), index(index), options(options), expanded(0) {}
 
-        void preprocess(Point const& q, uint32_t k, float const& a) override;
         void query(uint32_t k, Point const& q, float const& a, ResultSet &results, double &z_from_lp,
                 uint32_t &prunes, uint32_t &reheaps) override;
-
-        Index< variant > index;
+        void fill_stats(Stats &stats) const override;
+
+        /**
+         * Answers the queries from a page file through a buffer pool of num_frames pages,
+         * instead of building the index in memory.
+         * @return 0 if successful; 1 if the page file could not be opened (see PagedIndex::open)
+         */
+        int openPages(std::string const& filename, size_t const num_frames);
+
+        std::shared_ptr< Index const > index;
+        SearchOptions options;
+        PagedIndex< variant > paged;
+        uint32_t expanded; /**< the nodes expanded by the last query */
 
     };
 
@@ -3,68 +3,81 @@
  * A basic Priority Queue to keep the results
  */
 
-#ifndef TOPK_PRIORITY_QUEUE
-#define TOPK_PRIORITY_QUEUE
+#ifndef POPULAR_MBR_PRIORITY_QUEUE
+#define POPULAR_MBR_PRIORITY_QUEUE
 
-#include <queue>
+#include <algorithm> // std::push_heap(), std::pop_heap(), std::make_heap()
+#include <cstring> // std::memcpy()
+#include <vector>
 
 #include "commons.hpp"
-#include "../rtree/RTree.h"
+#include "topkPriorityQueue.hpp" // entryIsLess
 
 namespace popular
 {
-    struct entryIsGreater
+    /**
+     * Max-queue of branches by score; Branch is the handle of a branch, e.g. a branch
+     * number of the in-memory index or a copy of an on-disk branch record.
+     *
+     * The heap is kept in a plain vector, ordered as a std::priority_queue would be, so that
+     * the children of a node can be pushed in one call.
+     */
+    template < typename Branch >
+    class BasicMBRPriorityQueue
     {
-        template < typename T >
-        bool operator() ( T const l, T const r ) const
-        {
-            return l.second > r.second;
-        }
-    };
-
-    struct entryIsLess
-    {
-        template < typename T >
-        bool operator() ( T const l, T const r ) const
-        {
-            return l.second < r.second;
-        }
-    };
-
-    class MBRPriorityQueue
-    {
-        using PQEntry = std::pair< MyTree::Branch*, double >;
-        using Q = std::priority_queue< PQEntry, std::vector< PQEntry >, entryIsLess >;
+        using PQEntry = std::pair< Branch, double >;
 
-        Q q; /**< the candidates priority queue */
+        std::vector< PQEntry > q; /**< the candidates, as a max-heap on the score */
 
     public:
-        MBRPriorityQueue() {} /**< Empty constructor */
-        ~MBRPriorityQueue() {} /**< Empty destructor */
+        BasicMBRPriorityQueue() {} /**< Empty constructor */
+        ~BasicMBRPriorityQueue() {} /**< Empty destructor */
 
-        void add_to_queue(MyTree::Branch* const& branch, double score)
+        void add_to_queue(Branch const& branch, double score)
         {
-            q.push({branch, score});
+            q.emplace_back(branch, score);
+            std::push_heap(q.begin(), q.end(), entryIsLess());
+        }
+
+        /**
+         * Adds the n consecutive branches first, first + 1, ... with the given scores, in order.
+         * They are appended at once; when they are at least as many as the queue held, the
+         * heap is rebuilt in linear time instead of sifting each one up.
+         */
+        void add_to_queue(Branch const first, double const* scores, size_t const n)
+        {
+            size_t const old_size = q.size();
+            for (size_t i = 0; i < n; ++i) { q.emplace_back(first + i, scores[i]); }
+            if (n >= old_size)
+            {
+                std::make_heap(q.begin(), q.end(), entryIsLess());
+                return;
+            }
+            for (size_t i = old_size + 1; i <= q.size(); ++i)
+            {
+                std::push_heap(q.begin(), q.begin() + i, entryIsLess());
+            }
         }
 
         PQEntry return_best()
         {
-            PQEntry entry = q.top();
-            q.pop();
+            std::pop_heap(q.begin(), q.end(), entryIsLess());
+            PQEntry entry = q.back();
+            q.pop_back();
             return entry;
         }
 
         double peak_best_score() const
         {
-            return q.top().second;
+            return q.front().second;
         }
 
         void print()
         {
             while (!q.empty())
             {
-                std::cout << "id = " << q.top().first->id << "  score = " << q.top().second << std::endl;
-                q.pop();
+                std::cout << "id = " << q.front().first << "  score = " << q.front().second << std::endl;
+                return_best();
             }
         }
 
@@ -80,6 +93,158 @@ namespace popular
 
     };
 
+    using MBRPriorityQueue = BasicMBRPriorityQueue< uint32_t >; /**< by branch number of FlatTree */
+
+    /**
+     * The same max-queue as BasicMBRPriorityQueue on a D-ary heap: the heap is log_D as deep,
+     * so a push moves fewer entries, and the D children compared by a pop are adjacent.
+     */
+    template < typename Branch, unsigned D = 4 >
+    class DaryMBRPriorityQueue
+    {
+        using PQEntry = std::pair< Branch, double >;
+
+        std::vector< PQEntry > q; /**< the candidates, as a D-ary max-heap on the score */
+
+        void sift_up(size_t i)
+        {
+            PQEntry const entry = q[i];
+            while (i > 0 && q[(i - 1) / D].second < entry.second)
+            {
+                q[i] = q[(i - 1) / D];
+                i = (i - 1) / D;
+            }
+            q[i] = entry;
+        }
+
+        void sift_down(size_t i)
+        {
+            PQEntry const entry = q[i];
+            for (size_t child = D * i + 1; child < q.size(); child = D * i + 1)
+            {
+                size_t const end = std::min(child + D, q.size());
+                size_t best = child;
+                for (size_t c = child + 1; c < end; ++c)
+                {
+                    if (q[best].second < q[c].second) { best = c; }
+                }
+                if (!(entry.second < q[best].second)) { break; }
+                q[i] = q[best];
+                i = best;
+            }
+            q[i] = entry;
+        }
+
+    public:
+        void add_to_queue(Branch const& branch, double score)
+        {
+            q.emplace_back(branch, score);
+            sift_up(q.size() - 1);
+        }
+
+        /**
+         * As BasicMBRPriorityQueue::add_to_queue(): a batch at least as large as the queue is
+         * appended and the heap rebuilt bottom-up
+         */
+        void add_to_queue(Branch const first, double const* scores, size_t const n)
+        {
+            size_t const old_size = q.size();
+            if (n < old_size)
+            {
+                for (size_t i = 0; i < n; ++i) { add_to_queue(first + i, scores[i]); }
+                return;
+            }
+            for (size_t i = 0; i < n; ++i) { q.emplace_back(first + i, scores[i]); }
+            if (q.size() < 2) { return; }
+            for (size_t i = ( q.size() - 2 ) / D + 1; i-- > 0; ) { sift_down(i); }
+        }
+
+        PQEntry return_best()
+        {
+            PQEntry const entry = q.front();
+            q.front() = q.back();
+            q.pop_back();
+            if (!q.empty()) { sift_down(0); }
+            return entry;
+        }
+
+        double peak_best_score() const { return q.front().second; }
+        bool isEmpty() const { return q.empty(); }
+        size_t size() const { return q.size(); }
+    };
+
+    /**
+     * A max-queue of buckets over the scores, each bucket a binary heap that orders its
+     * entries exactly. The buckets follow the bits of the score, i.e. a radix on its
+     * exponent and leading mantissa bits, so they are as fine for the small contributions of
+     * the lower levels as for the large ones near the root. Scores below 2^-MIN_EXPONENT (or
+     * negative, for queries outside the extent of the data) share the lowest bucket, and
+     * scores of 1 or more the highest, where they are still ordered exactly.
+     *
+     * The scores of the search mostly decrease, so the highest non-empty bucket is found by
+     * moving down from the last one.
+     */
+    template < typename Branch >
+    class BucketMBRPriorityQueue
+    {
+        using PQEntry = std::pair< Branch, double >;
+
+        static int const MIN_EXPONENT = 32;
+        static int const SUB_BITS = 5; /**< the mantissa bits of a bucket, i.e. 32 buckets per power of two */
+        static size_t const NUM_BUCKETS = ( size_t( MIN_EXPONENT ) << SUB_BITS ) + 2;
+
+        std::vector< std::vector< PQEntry > > buckets;
+        size_t top = 0; /**< the highest non-empty bucket, if any */
+        size_t count = 0;
+
+        static size_t bucket(double const score)
+        {
+            uint64_t const min_bits = uint64_t( 1023 - MIN_EXPONENT ) << 52; // 2^-MIN_EXPONENT
+            if (!(score >= 1.0 / ( uint64_t( 1 ) << MIN_EXPONENT ))) { return 0; }
+            if (score >= 1.0) { return NUM_BUCKETS - 1; }
+            uint64_t bits;
+            std::memcpy(&bits, &score, sizeof(bits));
+            return 1 + ( ( bits - min_bits ) >> ( 52 - SUB_BITS ) );
+        }
+
+    public:
+        BucketMBRPriorityQueue() : buckets(NUM_BUCKETS) {}
+
+        void add_to_queue(Branch const& branch, double score)
+        {
+            size_t const b = bucket(score);
+            buckets[b].emplace_back(branch, score);
+            std::push_heap(buckets[b].begin(), buckets[b].end(), entryIsLess());
+            top = count++ == 0 ? b : std::max(top, b);
+        }
+
+        /**
+         * Pushes the branches one at a time: each goes to the small heap of its own bucket, so
+         * there is no single heap to rebuild
+         */
+        void add_to_queue(Branch const first, double const* scores, size_t const n)
+        {
+            for (size_t i = 0; i < n; ++i) { add_to_queue(first + i, scores[i]); }
+        }
+
+        PQEntry return_best()
+        {
+            std::vector< PQEntry > &best = buckets[top];
+            std::pop_heap(best.begin(), best.end(), entryIsLess());
+            PQEntry const entry = best.back();
+            best.pop_back();
+            if (--count > 0)
+            {
+                while (buckets[top].empty()) { --top; }
+            }
+            return entry;
+        }
+
+        double peak_best_score() const { return buckets[top].front().second; }
+        bool isEmpty() const { return count == 0; }
+        size_t size() const { return count; }
+    };
+
 } // namespace popular
 
 #endif
\ No newline at end of file
@@ -0,0 +1,125 @@
+/**
+ * @file
+ * Implementation of the CLOCK buffer pool.
+ */
+
+#include "bufferPool.hpp"
+#include "constants.hpp"
+
+#include <iostream>
+#include <algorithm> // std::min(), std::max()
+#include <limits> // std::numeric_limits
+#include <cstring> // std::memcpy(), std::strerror()
+#include <cerrno>
+#include <fcntl.h> // open()
+#include <sys/stat.h> // fstat()
+#include <unistd.h> // pread(), close()
+
+namespace popular
+{
+    namespace // anonymous
+    {
+        uint64_t const NO_PAGE = std::numeric_limits< uint64_t >::max();
+    } // namespace anonymous
+
+    int BufferPool::open( std::string const& filename, size_t const num_frames )
+    {
+        close();
+        fd_ = ::open( filename.c_str(), O_RDONLY );
+        if( fd_ < 0 )
+        {
+            std::cerr << "Could not open page file for reading: " << filename << std::endl;
+            return 1;
+        }
+        struct stat st;
+        if( fstat( fd_, &st ) != 0 )
+        {
+            std::cerr << "Could not determine the size of the page file: " << filename << std::endl;
+            close();
+            return 1;
+        }
+        file_size_ = st.st_size;
+
+        size_t const frames = std::max( num_frames, size_t( 1 ) );
+        frames_.assign( frames * Constants::DISK_PAGE_SIZE, '\0' );
+        frame_pages_.assign( frames, NO_PAGE );
+        referenced_.assign( frames, 0u );
+        page_frames_.clear();
+        page_frames_.reserve( frames );
+        hand_ = 0;
+        reset_counters();
+        return 0;
+    }
+
+    void BufferPool::close()
+    {
+        if( fd_ >= 0 ) { ::close( fd_ ); }
+        fd_ = -1;
+        file_size_ = 0;
+    }
+
+    char const* BufferPool::fetch( uint64_t const page )
+    {
+        auto const cached = page_frames_.find( page );
+        if( cached != page_frames_.end() )
+        {
+            ++hits_;
+            referenced_[ cached->second ] = 1u;
+            return frames_.data() + size_t( cached->second ) * Constants::DISK_PAGE_SIZE;
+        }
+
+        ++misses_;
+        while( referenced_[ hand_ ] ) // give referenced frames a second chance
+        {
+            referenced_[ hand_ ] = 0u;
+            hand_ = ( hand_ + 1 ) % frame_pages_.size();
+        }
+        size_t const frame = hand_;
+        hand_ = ( hand_ + 1 ) % frame_pages_.size();
+
+        if( frame_pages_[ frame ] != NO_PAGE ) { page_frames_.erase( frame_pages_[ frame ] ); }
+        frame_pages_[ frame ] = NO_PAGE;
+
+        // the bytes of the page that lie within the file must all be read
+        uint64_t const start = page * Constants::DISK_PAGE_SIZE;
+        size_t const expected = start < file_size_ ? std::min< uint64_t >( Constants::DISK_PAGE_SIZE, file_size_ - start ) : 0;
+        char* const data = frames_.data() + frame * Constants::DISK_PAGE_SIZE;
+        size_t got = 0;
+        while( got < expected )
+        {
+            ssize_t const n = pread( fd_, data + got, expected - got, start + got );
+            if( n < 0 && errno == EINTR ) { continue; }
+            if( n <= 0 )
+            {
+                std::cerr << "Could not read page " << page << " of the page file: "
+                          << ( n < 0 ? std::strerror( errno ) : "unexpected end of file" ) << std::endl;
+                return nullptr;
+            }
+            got += n;
+        }
+        std::fill( data + expected, data + Constants::DISK_PAGE_SIZE, '\0' ); // past the end of the file
+
+        frame_pages_[ frame ] = page;
+        referenced_[ frame ] = 1u;
+        page_frames_.emplace( page, static_cast< uint32_t >( frame ) );
+        return data;
+    }
+
+    int BufferPool::read( uint64_t const offset, size_t const n, void* out )
+    {
+        char* dest = static_cast< char* >( out );
+        for( uint64_t pos = offset; pos < offset + n; )
+        {
+            uint64_t const page = pos / Constants::DISK_PAGE_SIZE;
+            size_t const in_page = pos % Constants::DISK_PAGE_SIZE;
+            size_t const count = std::min( size_t( Constants::DISK_PAGE_SIZE - in_page ), size_t( offset + n - pos ) );
+            char const* const data = fetch( page );
+            if( data == nullptr ) { return 1; }
+            std::memcpy( dest, data + in_page, count );
+            dest += count;
+            pos += count;
+        }
+        return 0;
+    }
+
+} // namespace popular
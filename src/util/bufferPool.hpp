@@ -0,0 +1,75 @@
+/**
+ * @file
+ * A fixed-size cache of file pages with CLOCK eviction.
+ */
+
+#ifndef POPULAR_BUFFER_POOL
+#define POPULAR_BUFFER_POOL
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace popular
+{
+    /**
+     * Reads a file through num_frames in-memory frames of Constants::DISK_PAGE_SIZE bytes.
+     * A page that is not cached is read with pread() into the frame chosen by the CLOCK
+     * hand: the hand skips (and clears) frames referenced since its last pass and evicts
+     * the first unreferenced one, which approximates LRU without reordering on every hit.
+     * Only the part of a page past the end of the file is filled with zeros; a page that cannot
+     * be read in full is an error and is not cached.
+     */
+    class BufferPool
+    {
+    public:
+        BufferPool() : fd_( -1 ), file_size_( 0 ), hand_( 0 ), hits_( 0 ), misses_( 0 ) {}
+        ~BufferPool() { close(); }
+
+        BufferPool( BufferPool const& ) = delete;
+        BufferPool& operator = ( BufferPool const& ) = delete;
+
+        /**
+         * Opens the file read-only with an empty cache of num_frames pages.
+         * @return 0 if successful; 1 if the file could not be opened or its size not determined.
+         */
+        int open( std::string const& filename, size_t const num_frames );
+
+        void close();
+        bool is_open() const { return fd_ >= 0; }
+
+        /**
+         * Copies n bytes from the given file offset into out, fetching the pages they span.
+         * @return 0 if successful; 1 if a page could not be read, in which case out is incomplete.
+         */
+        int read( uint64_t const offset, size_t const n, void* out );
+
+        uint64_t file_size() const { return file_size_; }
+        uint64_t hits() const { return hits_; } /**< page requests served from the cache */
+        uint64_t misses() const { return misses_; } /**< page requests that read the file */
+        size_t num_frames() const { return frame_pages_.size(); }
+        void reset_counters() { hits_ = misses_ = 0; }
+
+    private:
+        /**
+         * @return the cached contents of the page, valid until the next fetch; nullptr if the
+         * page lies within the file but could not be read
+         */
+        char const* fetch( uint64_t const page );
+
+        int fd_;
+        uint64_t file_size_; /**< the size of the file when it was opened */
+        std::vector< char > frames_; /**< num_frames pages, back to back */
+        std::vector< uint64_t > frame_pages_; /**< the page held by each frame */
+        std::vector< uint8_t > referenced_; /**< the CLOCK reference bit of each frame */
+        std::unordered_map< uint64_t, uint32_t > page_frames_; /**< the frame of each cached page */
+        size_t hand_;
+        uint64_t hits_;
+        uint64_t misses_;
+    };
+
+} // namespace popular
+
+#endif
@@ -7,9 +7,74 @@
 #include "commons.hpp"
 
 #include <algorithm> // std::for_each()
+#include <cstring> // std::memcpy()
 
 namespace popular
 {
+    namespace // anonymous
+    {
+        /**
+         * FNV-1a over 32-bit words
+         */
+        template < typename T >
+        uint64_t hash_words( uint64_t h, ArrayView< T > const& words )
+        {
+            static_assert( sizeof( T ) == sizeof( uint32_t ), "hashes 32-bit words" );
+            for( auto const& w : words )
+            {
+                uint32_t bits;
+                std::memcpy( &bits, &w, sizeof( bits ) );
+                h = ( h ^ bits ) * 0x100000001b3ull;
+            }
+            return h;
+        }
+    } // namespace anonymous
+
+    size_t Corpus::num_entries() const
+    {
+        if( ends.empty() ) { return checkin_users.size(); }
+        size_t entries = 0;
+        for( PoiId p = 0; p < num_places(); ++p ) { entries += ends[ p ] - offsets[ p ]; }
+        return entries;
+    }
+
+    Corpus Corpus::compacted() const
+    {
+        if( ends.empty() ) { return *this; }
+
+        CorpusArrays arrays;
+        arrays.xs.assign( xs.cbegin(), xs.cend() );
+        arrays.ys.assign( ys.cbegin(), ys.cend() );
+        arrays.user_labels.assign( user_labels.cbegin(), user_labels.cend() );
+        arrays.offsets.resize( num_places() + 1 );
+        arrays.checkin_users.reserve( num_entries() );
+        for( PoiId p = 0; p < num_places(); ++p )
+        {
+            arrays.offsets[ p ] = arrays.checkin_users.size();
+            UserList const users = checkins( p );
+            arrays.checkin_users.insert( arrays.checkin_users.end(), users.cbegin(), users.cend() );
+        }
+        arrays.offsets[ num_places() ] = arrays.checkin_users.size();
+
+        Corpus corpus( *this );
+        corpus.assign( std::move( arrays ) );
+        return corpus;
+    }
+
+    /**
+     * The hash of the compact layout, so that it does not depend on the gaps updates left.
+     */
+    uint64_t Corpus::fingerprint() const
+    {
+        if( !ends.empty() ) { return compacted().fingerprint(); }
+
+        uint64_t h = 0xcbf29ce484222325ull;
+        h = hash_words( h, xs );
+        h = hash_words( h, ys );
+        h = hash_words( h, offsets );
+        return hash_words( h, checkin_users );
+    }
+
     std::ostream& operator << (std::ostream &o, const Point &p)
     {
         return o << "(" << p.first << "," << p.second << ")";
@@ -20,10 +85,10 @@ namespace popular
         o << " XMIN = " << c.xmin << " YMIN = " << c.ymin << std::endl;
         o << " XMAX = " << c.xmax << " YMAX = " << c.ymax << std::endl;
         o << " Max distance = " << c.max_distance << std::endl;
-        for (auto const& check : c.checkins)
+        for (PoiId p = 0; p < c.num_places(); ++p)
         {
-            o << check.first << " -> ";
-            for (auto const& us : check.second) { o << us << " "; }
+            o << c.point(p) << " -> ";
+            for (auto const us : c.checkins(p)) { o << c.user_labels[us] << " "; }
             o << std::endl;
         }
         return o;
@@ -47,30 +112,46 @@ namespace popular
           << stats.microseconds_q << "\t" << stats.microseconds_retrieve << "\t"
           << stats.microseconds_all << "\t" << stats.peak_rss << "\t" << stats.num_points << "\t"
           << stats.num_users << "\t" << stats.num_checkins << "\t" << stats.z_from_lp << "\t" << stats.actual_score
-          << "\t" << stats.prunes << "\t" << stats.reheaps;
+          << "\t" << stats.prunes << "\t" << stats.reheaps << "\t" << stats.page_hits << "\t" << stats.page_misses
+          << "\t" << stats.tree_depth << "\t" << stats.tree_nodes << "\t" << stats.nodes_expanded;
         return o;
     }
 
     std::ostream& operator << (std::ostream &o, Headers const&)
     {
         o << "\033[95mDataset\tAlgorithm\tAlg index\tQuery\tQ index\tk\ta\tPreprocess time\tQuery time\tRetrieve time"
-             "\tTotal time\tPeak RSS\tPoints\tUsers\tCheckins\tZ\tScore\tPrunes\tReheaps\033[00m";
+             "\tTotal time\tPeak RSS\tPoints\tUsers\tCheckins\tZ\tScore\tPrunes\tReheaps\tPage hits\tPage misses"
+             "\tDepth\tNodes\tExpanded\033[00m";
         return o;
     }
 
     std::ostream& operator << (std::ostream &o, IntermediateRes const& intermediateRes)
     {
         o << "Coverage: " << std::endl;
-        for(auto const& u : intermediateRes.coverage) { o << u << " "; }
+        intermediateRes.coverage.for_each( [ &o ]( UserId const u ){ o << u << " "; } );
         o << std::endl << "Distance = " << intermediateRes.distance << std::endl;
         return o;
     }
 
-    double score( Point const q, Point const p, std::vector< UserId > const& users, double const max_dist,
+    namespace // anonymous
+    {
+    template < typename Users >
+    size_t uncovered( Coverage const& coverage, Users const& users )
+    {
+        return coverage.uncovered( users );
+    }
+
+    size_t uncovered( Coverage const& coverage, HybridSet const& users )
+    {
+        return users.count_not_in( coverage );
+    }
+
+    template < typename Users >
+    double score_impl( Point const q, Point const p, Users const& users, double const max_dist,
                  uint32_t const k, uint32_t const tot_users, float const a_param, IntermediateRes const& intermediateRes)
     {
         double d, u;
-        if(intermediateRes.coverage.size() == 0)
+        if(intermediateRes.coverage.empty())
         {
             d = ( 1 - (distance(q, p)/max_dist) ) / k;
             u = (double) users.size() / tot_users;
@@ -79,31 +160,67 @@ namespace popular
         {
             d = ( 1 - distance( p, q ) / max_dist + intermediateRes.distance ) / k;
 
-            u = set_union_size( intermediateRes.coverage, users )
+            u = ( intermediateRes.coverage.size() + uncovered( intermediateRes.coverage, users ) )
               / static_cast< double >( tot_users );
         }
 
         return the_score(d, u, a_param);
     }
 
-    double contribution( Point const q, Point const p, std::vector< UserId > const& users, double const max_dist,
+    template < typename Users >
+    double contribution_impl( Point const q, Point const p, Users const& users, double const max_dist,
             uint32_t const k, UserId const tot_users, float const a_param, IntermediateRes const& intermediateRes)
     {
         auto const d = ( 1 - distance( p, q ) / max_dist ) / k;
-        auto const u = intermediateRes.coverage.size() == 0
+        auto const u = intermediateRes.coverage.empty()
                      ? users.size()
-                     : set_difference_size( users, intermediateRes.coverage );
+                     : uncovered( intermediateRes.coverage, users );
 
         return the_score( d, u / static_cast< double >( tot_users ), a_param );
     }
+    } // namespace anonymous
+
+    double score( Point const q, Point const p, UserList const users, double const max_dist,
+                 uint32_t const k, uint32_t const tot_users, float const a_param, IntermediateRes const& intermediateRes)
+    {
+        return score_impl( q, p, users, max_dist, k, tot_users, a_param, intermediateRes );
+    }
+
+    double score( Point const q, Point const p, HybridSet const& users, double const max_dist,
+                 uint32_t const k, uint32_t const tot_users, float const a_param, IntermediateRes const& intermediateRes)
+    {
+        return score_impl( q, p, users, max_dist, k, tot_users, a_param, intermediateRes );
+    }
+
+    double contribution( Point const q, Point const p, UserList const users, double const max_dist,
+            uint32_t const k, UserId const tot_users, float const a_param, IntermediateRes const& intermediateRes)
+    {
+        return contribution_impl( q, p, users, max_dist, k, tot_users, a_param, intermediateRes );
+    }
+
+    double contribution( Point const q, Point const p, HybridSet const& users, double const max_dist,
+            uint32_t const k, UserId const tot_users, float const a_param, IntermediateRes const& intermediateRes)
+    {
+        return contribution_impl( q, p, users, max_dist, k, tot_users, a_param, intermediateRes );
+    }
+
+    void addIntermediate( IntermediateRes & intermediateRes
+                        , Point const q
+                        , Point const p
+                        , double const max_dist
+                        , UserList const users )
+    {
+        intermediateRes.coverage.add( users );
+        intermediateRes.distance += 1.0 - distance( p, q ) / max_dist;
+    }
 
     void addIntermediate( IntermediateRes & intermediateRes
                         , Point const q
                         , Point const p
                         , double const max_dist
-                        , std::vector< UserId > const& users )
+                        , HybridSet const& users )
     {
-        intermediateRes.coverage  = my_set_union( users, intermediateRes.coverage );
+        users.add_to( intermediateRes.coverage );
         intermediateRes.distance += 1.0 - distance( p, q ) / max_dist;
     }
 
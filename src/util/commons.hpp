@@ -15,18 +15,73 @@
 #include <cfloat> // for min and max values
 #include <numeric> // std::accumulate
 #include <limits> // std::numeric_limits
+#include <memory> // std::shared_ptr
 
 #include "constants.hpp"
-#include "set-operations.hpp"
+#include "coverage.hpp"
+#include "hybridSet.hpp"
 
 namespace popular
 {
     using coordinate = float;
     using Point = std::pair< coordinate, coordinate >; /**< a point is a pair of <latitude, longitude> */
-    using PointsSet = std::unordered_set< Point, boost::hash< Point > >; /**< unordered_set with Point */
-    using UserId = uint32_t;
-    using ResultSet = std::pair< PointsSet, double >; /**< the result is a pair of a set of points and a score. */
+    using UserId = uint32_t; /**< dense user id in [0, num_users) */
+    using PoiId = uint32_t; /**< dense POI id in [0, num_places) */
+    using PoiSet = std::vector< PoiId >; /**< a set of distinct POI ids */
+    using ResultSet = std::pair< PoiSet, double >; /**< the result is a pair of a set of POIs and a score. */
 
+    /**
+     * A non-owning, read-only view over a contiguous array, e.g. the check-ins of one POI.
+     */
+    template < typename T >
+    class ArrayView
+    {
+    public:
+        using value_type = T;
+        using const_iterator = T const*;
+
+        ArrayView() : first_( nullptr ), last_( nullptr ) {}
+        ArrayView( T const* first, T const* last ) : first_( first ), last_( last ) {}
+        ArrayView( std::vector< T > const& v ) : first_( v.data() ), last_( v.data() + v.size() ) {}
+
+        const_iterator begin() const { return first_; }
+        const_iterator end() const { return last_; }
+        const_iterator cbegin() const { return first_; }
+        const_iterator cend() const { return last_; }
+        size_t size() const { return last_ - first_; }
+        bool empty() const { return first_ == last_; }
+        T const& operator [] ( size_t i ) const { return first_[ i ]; }
+        T const* data() const { return first_; }
+
+    private:
+        T const* first_;
+        T const* last_;
+    };
+
+    using UserList = ArrayView< UserId >; /**< the sorted, unique users of a POI or MBR */
+
+    /**
+     * The heap-allocated arrays of a corpus, as produced by the CorpusBuilder.
+     */
+    struct CorpusArrays
+    {
+        std::vector< coordinate > xs;
+        std::vector< coordinate > ys;
+        std::vector< uint32_t > offsets;
+        std::vector< UserId > checkin_users;
+        std::vector< uint32_t > user_labels;
+    };
+
+    /**
+     * The dataset. POIs and users are interned to dense ids; the coordinates of POI i are
+     * (xs[i], ys[i]) and its sorted, unique users are the CSR slice
+     * checkin_users[offsets[i], offsets[i+1]), or checkin_users[offsets[i], ends[i]) after a
+     * CorpusUpdater moved the users of some POIs to the end of checkin_users.
+     * The arrays are read-only views into a storage that is either owned CorpusArrays or
+     * a memory-mapped snapshot file; copies of a Corpus share that storage.
+     * @see CorpusBuilder for how to construct one, CorpusUpdater for how to append check-ins
+     * and corpusSnapshot.hpp for the binary format.
+     */
     typedef struct Corpus
     {
         Corpus() : xmin( std::numeric_limits< coordinate >::max() )
@@ -34,14 +89,63 @@ namespace popular
                  , ymin( std::numeric_limits< coordinate >::max() )
                  , ymax( std::numeric_limits< coordinate >::max() * -1 )
                  , max_distance( std::numeric_limits< coordinate >::max() * -1 )
-                 , num_checkins(0) {};
+                 , num_checkins(0)
+                 , version(0) {};
 
-        PointsSet places;
-        std::unordered_set< UserId > users;
-        std::unordered_map< Point, std::vector< UserId >, boost::hash< Point > > checkins;
         float xmin, xmax, ymin, ymax;
         double max_distance;
-        uint32_t num_checkins;
+        uint32_t num_checkins; /**< the number of input check-ins, including repeated visits */
+        uint32_t version; /**< incremented by every CorpusUpdater::apply(), so derived structures can detect staleness */
+
+        ArrayView< coordinate > xs; /**< the first coordinate of each POI */
+        ArrayView< coordinate > ys; /**< the second coordinate of each POI */
+        ArrayView< uint32_t > offsets; /**< CSR offsets into checkin_users; size is num_places() + 1 */
+        ArrayView< UserId > checkin_users; /**< CSR check-ins; the users of each POI are sorted and unique */
+        ArrayView< uint32_t > ends; /**< empty when the CSR is compact; otherwise where the users of each POI end */
+        ArrayView< uint32_t > user_labels; /**< the user id from the input file for each dense user id */
+        std::shared_ptr< void const > storage; /**< keeps the memory behind the views alive */
+
+        size_t num_places() const { return xs.size(); }
+        size_t num_users() const { return user_labels.size(); }
+
+        /**
+         * @return the number of (POI, user) pairs, without the gaps that updates left in checkin_users
+         */
+        size_t num_entries() const;
+
+        /**
+         * @return a hash of the coordinates and the check-ins, to detect files derived from
+         * another corpus
+         */
+        uint64_t fingerprint() const;
+
+        /**
+         * @return this corpus with the users of the POIs stored in order, without gaps, in
+         * owned storage; the corpus itself if it is compact already
+         */
+        Corpus compacted() const;
+
+        /**
+         * Takes ownership of the arrays and points the views at them.
+         */
+        void assign( CorpusArrays && arrays )
+        {
+            auto const owned = std::make_shared< CorpusArrays const >( std::move( arrays ) );
+            xs = owned->xs;
+            ys = owned->ys;
+            offsets = owned->offsets;
+            checkin_users = owned->checkin_users;
+            user_labels = owned->user_labels;
+            ends = ArrayView< uint32_t >();
+            storage = owned;
+        }
+
+        Point point( PoiId const p ) const { return Point( xs[ p ], ys[ p ] ); }
+
+        UserList checkins( PoiId const p ) const
+        {
+            return UserList( checkin_users.data() + offsets[ p ], checkin_users.data() + ( ends.empty() ? offsets[ p + 1 ] : ends[ p ] ) );
+        }
     } Corpus;
 
     /**
@@ -68,6 +172,11 @@ namespace popular
         long double actual_score;
         uint32_t prunes;
         uint32_t reheaps;
+        uint64_t page_hits; /**< buffer pool hits of the paged R-tree */
+        uint64_t page_misses; /**< buffer pool misses, i.e. pages read from disk */
+        uint32_t tree_depth; /**< levels of the R-tree */
+        uint32_t tree_nodes; /**< nodes of the R-tree */
+        uint32_t nodes_expanded; /**< R-tree nodes whose branches were scored */
     };
 
     /**
@@ -76,7 +185,7 @@ namespace popular
      */
     struct IntermediateRes
     {
-        std::vector< UserId > coverage;
+        Coverage coverage; /**< the users covered by the chosen POIs; sized to the number of users */
         double distance;
     };
 
@@ -104,13 +213,15 @@ namespace popular
     /**
      * Calculated the distance between a point a set of points
      * @param q : the point
-     * @param points : the set of points
+     * @param corpus : the corpus that the POIs belong to
+     * @param points : the set of POIs
      * @return : float the distance between the point and the sets
      */
-    double inline distance( Point const q, PointsSet const& points, double const max_dist, uint32_t const k )
+    double inline distance( Point const q, Corpus const& corpus, PoiSet const& points, double const max_dist,
+            uint32_t const k )
     {
         double dist = std::accumulate (points.cbegin(), points.cend(), 0.0,
-                [ q, max_dist ]( auto i, auto p ){ return i + ( 1 - ( distance(q, p) / max_dist ) ); });
+                [ q, max_dist, &corpus ]( auto i, auto p ){ return i + ( 1 - ( distance(q, corpus.point(p)) / max_dist ) ); });
         return dist/k;
     }
 
@@ -138,7 +249,9 @@ namespace popular
      * @param intermediateRes : the intermediate results
      * @return : the score of the point
      */
-    double score( Point const q, Point const p, std::vector< UserId > const& users, double const max_dist,
+    double score( Point const q, Point const p, UserList const users, double const max_dist,
+            uint32_t const k, uint32_t const tot_users, float const a_param, IntermediateRes const& intermediateRes);
+    double score( Point const q, Point const p, HybridSet const& users, double const max_dist,
             uint32_t const k, uint32_t const tot_users, float const a_param, IntermediateRes const& intermediateRes);
 
     /**
@@ -154,7 +267,9 @@ namespace popular
      * @param intermediateRes : the intermediate results
      * @return : the contribution of the point
      */
-    double contribution( Point const q, Point const p, std::vector< UserId > const& users, double const max_dist,
+    double contribution( Point const q, Point const p, UserList const users, double const max_dist,
+            uint32_t const k, UserId const tot_users, float const a_param, IntermediateRes const& intermediateRes);
+    double contribution( Point const q, Point const p, HybridSet const& users, double const max_dist,
             uint32_t const k, UserId const tot_users, float const a_param, IntermediateRes const& intermediateRes);
 
     /**
@@ -169,7 +284,12 @@ namespace popular
                         , Point const q
                         , Point const p
                         , double const max_dist
-                        , std::vector< UserId > const& users );
+                        , UserList const users );
+    void addIntermediate( IntermediateRes &intermediateRes
+                        , Point const q
+                        , Point const p
+                        , double const max_dist
+                        , HybridSet const& users );
 
     /**
     * Calculates the number of users checked in to a set of points
@@ -180,18 +300,17 @@ namespace popular
     {
         Corpus const& corpus_;
 
-        double operator () (PointsSet const& points) const
+        double operator () (PoiSet const& points) const
         {
-            std::vector< UserId > unique_users;
+            Coverage unique_users( corpus_.num_users() );
 
             std::for_each(points.cbegin(), points.cend(),
-                    [this, &unique_users](Point const& p)
+                    [this, &unique_users](PoiId const p)
                     {
-                        unique_users = my_set_union ( this->corpus_.checkins.at(p)
-                                                    , unique_users );
+                        unique_users.add( this->corpus_.checkins(p) );
                     });
 
-            return ((double)unique_users.size() / corpus_.users.size());
+            return ((double)unique_users.size() / corpus_.num_users());
         }
     };
 
@@ -201,15 +320,15 @@ namespace popular
         float const a;
         uint32_t k;
 
-        double operator () ( Point const q, Point const p, IntermediateRes const& intermediateRes ) const
+        double operator () ( Point const q, PoiId const p, IntermediateRes const& intermediateRes ) const
         {
-            return score(q, p, users.corpus_.checkins.at(p), users.corpus_.max_distance, k, users.corpus_.users.size(),
-                         a, intermediateRes);
+            return score(q, users.corpus_.point(p), users.corpus_.checkins(p), users.corpus_.max_distance, k,
+                         users.corpus_.num_users(), a, intermediateRes);
         }
 
-        double operator () ( Point const q, PointsSet const& points ) const
+        double operator () ( Point const q, PoiSet const& points ) const
         {
-            double dist = distance(q, points, users.corpus_.max_distance, k);
+            double dist = distance(q, users.corpus_, points, users.corpus_.max_distance, k);
             double us_n = users(points);
             return the_score(dist, us_n, a);
         }
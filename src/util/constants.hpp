@@ -6,12 +6,29 @@
 #ifndef CONSTANTS
 #define CONSTANTS
 
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
 namespace popular
 {
     namespace Constants
     {
         std::string const RESULT_FILE = "../results_log.txt"; /**< The result output file */
-        int const RTREEMAXNODES = 4;
+        int const RTREEMAXNODES = 4; /**< The default fan-out of the R-tree */
+        int const RTREE_FANOUTS[] = { 4, 8, 16, 32, 64 }; /**< The fan-outs the R-tree index is compiled for */
+        int const RTREE_MAX_FANOUT = 64;
+        size_t const RTREE_SOCIAL_WINDOW = 4; /**< The leaves regrouped together by the social bulk load */
+        double const RTREE_SOCIAL_SPATIAL_WEIGHT = 0.5; /**< The weight of the MBR growth against the user overlap */
+        uint32_t const QUADTREE_MAX_DEPTH = 32; /**< The subdivisions of a cell before its POIs are split in order instead */
+        char const SNAPSHOT_MAGIC[ 8 ] = { 'P', 'O', 'P', 'C', 'O', 'R', 'P', '\0' }; /**< First bytes of a corpus snapshot */
+        uint32_t const SNAPSHOT_VERSION = 1; /**< Bump whenever the snapshot layout changes */
+        double const CORPUS_UPDATE_SLACK = 0.5; /**< The room CorpusUpdater leaves for appends, relative to the corpus */
+        size_t const DISK_PAGE_SIZE = 4096; /**< The unit of I/O of the paged R-tree and its buffer pool */
+        char const PAGED_INDEX_MAGIC[ 8 ] = { 'P', 'O', 'P', 'P', 'A', 'G', 'E', '\0' }; /**< First bytes of an R-tree page file */
+        uint32_t const PAGED_INDEX_VERSION = 2; /**< Bump whenever the page file layout changes */
+        char const INDEX_FILE_MAGIC[ 8 ] = { 'P', 'O', 'P', 'I', 'N', 'D', 'X', '\0' }; /**< First bytes of a saved R-tree index */
+        uint32_t const INDEX_FILE_VERSION = 2; /**< Bump whenever the index file layout changes */
     } // namespace Constants
 } // namespace popular
 
@@ -0,0 +1,97 @@
+/**
+ * @file
+ * Implementation of the Corpus builder.
+ */
+
+#include "corpusBuilder.hpp"
+
+#include <algorithm> // std::sort(), std::unique(), std::lower_bound()
+
+namespace popular
+{
+
+void CorpusBuilder::add( uint32_t const user, Point const& point )
+{
+	auto const [ it, inserted ] = poi_ids_.emplace( point, static_cast< PoiId >( places_.size() ) );
+	if( inserted ) { places_.push_back( point ); }
+	checkins_.emplace_back( it->second, user );
+}
+
+/**
+ * Interns the users by rank of their input id, then counting-sorts the check-ins by POI
+ * into the CSR arrays and finally sorts and deduplicates each POI's slice in place.
+ */
+void CorpusBuilder::build( Corpus &corpus )
+{
+	corpus = Corpus();
+
+	std::vector< uint32_t > labels;
+	labels.reserve( checkins_.size() );
+	for( auto const& checkin : checkins_ ) { labels.push_back( checkin.second ); }
+	std::sort( labels.begin(), labels.end() );
+	labels.erase( std::unique( labels.begin(), labels.end() ), labels.end() );
+
+	size_t const n = places_.size();
+	CorpusArrays arrays;
+	arrays.offsets.assign( n + 1, 0 );
+	for( auto const& checkin : checkins_ ) { ++arrays.offsets[ checkin.first + 1 ]; }
+	for( size_t p = 0; p < n; ++p ) { arrays.offsets[ p + 1 ] += arrays.offsets[ p ]; }
+
+	arrays.checkin_users.resize( checkins_.size() );
+	std::vector< uint32_t > cursor( arrays.offsets.cbegin(), arrays.offsets.cend() - 1 );
+	for( auto const& checkin : checkins_ )
+	{
+		auto const user = std::lower_bound( labels.cbegin(), labels.cend(), checkin.second ) - labels.cbegin();
+		arrays.checkin_users[ cursor[ checkin.first ]++ ] = static_cast< UserId >( user );
+	}
+
+	std::vector< uint32_t > unique_counts( n );
+	#pragma omp parallel for schedule(dynamic, 1024)
+	for( size_t p = 0; p < n; ++p )
+	{
+		auto const first = arrays.checkin_users.begin() + arrays.offsets[ p ];
+		auto const last = arrays.checkin_users.begin() + arrays.offsets[ p + 1 ];
+		std::sort( first, last );
+		unique_counts[ p ] = std::unique( first, last ) - first;
+	}
+
+	uint32_t out = 0;
+	for( size_t p = 0; p < n; ++p )
+	{
+		auto const first = arrays.checkin_users.begin() + arrays.offsets[ p ];
+
+		arrays.offsets[ p ] = out;
+		out = std::move( first, first + unique_counts[ p ], arrays.checkin_users.begin() + out )
+		    - arrays.checkin_users.begin();
+	}
+	arrays.offsets[ n ] = out;
+	arrays.checkin_users.resize( out );
+	arrays.checkin_users.shrink_to_fit();
+
+	arrays.xs.reserve( n );
+	arrays.ys.reserve( n );
+	for( auto const& point : places_ )
+	{
+		arrays.xs.push_back( point.first );
+		arrays.ys.push_back( point.second );
+
+		corpus.xmin = std::min( corpus.xmin, point.first );
+		corpus.xmax = std::max( corpus.xmax, point.first );
+		corpus.ymin = std::min( corpus.ymin, point.second );
+		corpus.ymax = std::max( corpus.ymax, point.second );
+	}
+
+	arrays.user_labels = std::move( labels );
+	corpus.assign( std::move( arrays ) );
+	corpus.num_checkins = checkins_.size();
+
+	Point pmin = std::make_pair(corpus.xmin, corpus.ymin);
+	Point pmax = std::make_pair(corpus.xmax, corpus.ymax);
+	corpus.max_distance = distance(pmin, pmax);
+
+	poi_ids_.clear();
+	places_.clear();
+	checkins_.clear();
+}
+
+} // namespace popular
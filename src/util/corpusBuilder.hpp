@@ -0,0 +1,57 @@
+/**
+ * @file
+ * Incremental construction of the dense-id, CSR-layout Corpus.
+ */
+
+#ifndef CORPUS_BUILDER
+#define CORPUS_BUILDER
+
+#include <vector>
+#include <unordered_map>
+
+#include "commons.hpp"
+
+namespace popular
+{
+
+/**
+ * Collects raw check-ins (user id from the input, point) and interns them into
+ * a Corpus with dense POI and user ids.
+ */
+class CorpusBuilder {
+
+public:
+	CorpusBuilder() {} /**< Empty constructor. */
+	~CorpusBuilder() {} /**< Empty destructor. */
+
+	/**
+	 * Records one check-in.
+	 * @param user : the user id as it appears in the input
+	 * @param point : the location of the POI
+	 */
+	void add( uint32_t const user, Point const& point );
+
+	/**
+	 * Reserves space for the given number of check-ins.
+	 */
+	void reserve( size_t const num_checkins ) { checkins_.reserve( num_checkins ); }
+
+	/**
+	 * Interns the recorded check-ins into a corpus.
+	 * POI ids follow the order of first appearance; user ids follow the order of the input user ids,
+	 * so that sorted lists of dense ids are also sorted by input id.
+	 *
+	 * @param corpus The object into which the check-ins should be loaded.
+	 * @post All contents of corpus are erased and replaced; the builder is emptied.
+	 */
+	void build( Corpus &corpus );
+
+private:
+	std::unordered_map< Point, PoiId, boost::hash< Point > > poi_ids_; /**< the dense id of each point */
+	std::vector< Point > places_; /**< the point of each dense POI id */
+	std::vector< std::pair< PoiId, uint32_t > > checkins_; /**< (POI id, input user id) per check-in */
+};
+
+} // namespace popular
+
+#endif
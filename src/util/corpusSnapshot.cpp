@@ -0,0 +1,202 @@
+/**
+ * @file
+ * Implementation of the corpus snapshot reader and writer.
+ */
+
+#include "corpusSnapshot.hpp"
+#include "constants.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cstring> // std::memcmp(), std::memcpy()
+#include <fcntl.h> // open()
+#include <unistd.h> // close()
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h> // fstat()
+
+namespace popular
+{
+
+namespace // anonymous
+{
+    uint64_t const ALIGNMENT = 64;
+
+    uint64_t align( uint64_t const offset )
+    {
+        return ( offset + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT;
+    }
+
+    /**
+     * Writes the array and pads the stream up to the next section boundary.
+     */
+    template < typename T >
+    void write_section( std::ofstream &out, ArrayView< T > const& array )
+    {
+        out.write( reinterpret_cast< char const* >( array.data() ), array.size() * sizeof( T ) );
+        uint64_t const end = out.tellp();
+        for( uint64_t i = end; i < align( end ); ++i ) { out.put( '\0' ); }
+    }
+
+    /**
+     * Points the view at a section of the mapping, if it lies within the file.
+     */
+    template < typename T >
+    bool map_section( char const* base, uint64_t const file_size, uint64_t const offset, uint64_t const count,
+            ArrayView< T > &array )
+    {
+        if( offset % ALIGNMENT != 0 || offset > file_size || count > ( file_size - offset ) / sizeof( T ) )
+        {
+            return false;
+        }
+        auto const first = reinterpret_cast< T const* >( base + offset );
+        array = ArrayView< T >( first, first + count );
+        return true;
+    }
+
+    /**
+     * Checks that the offsets start at 0 and never decrease, so that each POI's check-ins lie
+     * within the users section, and that each POI lists increasing user ids below num_users.
+     */
+    bool valid_checkins( Corpus const& corpus, uint64_t const num_users )
+    {
+        ArrayView< uint32_t > const& offsets = corpus.offsets;
+        if( offsets[ 0 ] != 0 ) { return false; }
+        for( size_t p = 0; p + 1 < offsets.size(); ++p )
+        {
+            if( offsets[ p + 1 ] < offsets[ p ] || offsets[ p + 1 ] > corpus.checkin_users.size() ) { return false; }
+            for( uint32_t i = offsets[ p ]; i < offsets[ p + 1 ]; ++i )
+            {
+                UserId const u = corpus.checkin_users[ i ];
+                if( u >= num_users || ( i > offsets[ p ] && u <= corpus.checkin_users[ i - 1 ] ) ) { return false; }
+            }
+        }
+        return true;
+    }
+} // namespace anonymous
+
+bool CorpusSnapshot::isSnapshot( std::string const& filename )
+{
+	std::ifstream in( filename, std::ios::binary );
+	char magic[ sizeof( Constants::SNAPSHOT_MAGIC ) ];
+	return in.read( magic, sizeof( magic ) )
+	    && std::memcmp( magic, Constants::SNAPSHOT_MAGIC, sizeof( magic ) ) == 0;
+}
+
+int CorpusSnapshot::write( std::string const& filename, Corpus const& updated ) const
+{
+	Corpus const corpus = updated.compacted();
+	std::ofstream out( filename, std::ios::binary | std::ios::trunc );
+	if( !out )
+	{
+		std::cerr << "Could not open snapshot file for writing: " << filename << std::endl;
+		return 1;
+	}
+
+	SnapshotHeader header;
+	std::memset( &header, 0, sizeof( header ) );
+	std::memcpy( header.magic, Constants::SNAPSHOT_MAGIC, sizeof( header.magic ) );
+	header.version = Constants::SNAPSHOT_VERSION;
+	header.header_size = sizeof( SnapshotHeader );
+	header.num_places = corpus.num_places();
+	header.num_users = corpus.num_users();
+	header.num_entries = corpus.num_entries();
+	header.num_checkins = corpus.num_checkins;
+	header.xmin = corpus.xmin;
+	header.xmax = corpus.xmax;
+	header.ymin = corpus.ymin;
+	header.ymax = corpus.ymax;
+	header.max_distance = corpus.max_distance;
+
+	std::vector< uint32_t > const empty_offsets( 1, 0 );
+	ArrayView< uint32_t > const offsets = corpus.offsets.empty() ? ArrayView< uint32_t >( empty_offsets )
+	                                                             : corpus.offsets;
+
+	header.xs_offset = align( sizeof( SnapshotHeader ) );
+	header.ys_offset = align( header.xs_offset + header.num_places * sizeof( coordinate ) );
+	header.offsets_offset = align( header.ys_offset + header.num_places * sizeof( coordinate ) );
+	header.checkin_users_offset = align( header.offsets_offset + offsets.size() * sizeof( uint32_t ) );
+	header.user_labels_offset = align( header.checkin_users_offset + header.num_entries * sizeof( UserId ) );
+	header.file_size = align( header.user_labels_offset + header.num_users * sizeof( uint32_t ) );
+
+	out.write( reinterpret_cast< char const* >( &header ), sizeof( header ) );
+	for( uint64_t i = sizeof( header ); i < header.xs_offset; ++i ) { out.put( '\0' ); }
+	write_section( out, corpus.xs );
+	write_section( out, corpus.ys );
+	write_section( out, offsets );
+	write_section( out, corpus.checkin_users );
+	write_section( out, corpus.user_labels );
+
+	if( !out )
+	{
+		std::cerr << "Could not write snapshot file: " << filename << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int CorpusSnapshot::map( std::string const& filename, Corpus &corpus ) const
+{
+	int const fd = open( filename.c_str(), O_RDONLY );
+	if( fd < 0 )
+	{
+		std::cerr << "Could not open snapshot file for reading: " << filename << std::endl;
+		return 1;
+	}
+
+	struct stat st;
+	if( fstat( fd, &st ) != 0 || static_cast< uint64_t >( st.st_size ) < sizeof( SnapshotHeader ) )
+	{
+		std::cerr << "Snapshot file is truncated: " << filename << std::endl;
+		close( fd );
+		return 1;
+	}
+
+	uint64_t const file_size = st.st_size;
+	void* const addr = mmap( nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd ); // the mapping keeps its own reference to the file
+	if( addr == MAP_FAILED )
+	{
+		std::cerr << "Could not map snapshot file: " << filename << std::endl;
+		return 1;
+	}
+	std::shared_ptr< void const > const mapping( addr, [ file_size ]( void const* p )
+	                                            { munmap( const_cast< void* >( p ), file_size ); } );
+
+	char const* const base = static_cast< char const* >( addr );
+	SnapshotHeader const& header = *reinterpret_cast< SnapshotHeader const* >( base );
+	if( std::memcmp( header.magic, Constants::SNAPSHOT_MAGIC, sizeof( header.magic ) ) != 0
+	 || header.version != Constants::SNAPSHOT_VERSION
+	 || header.header_size != sizeof( SnapshotHeader )
+	 || header.file_size != file_size )
+	{
+		std::cerr << "Not a compatible snapshot (expected version " << Constants::SNAPSHOT_VERSION << "): "
+		          << filename << std::endl;
+		return 1;
+	}
+
+	Corpus mapped;
+	if( !map_section( base, file_size, header.xs_offset, header.num_places, mapped.xs )
+	 || !map_section( base, file_size, header.ys_offset, header.num_places, mapped.ys )
+	 || !map_section( base, file_size, header.offsets_offset, header.num_places + 1, mapped.offsets )
+	 || !map_section( base, file_size, header.checkin_users_offset, header.num_entries, mapped.checkin_users )
+	 || !map_section( base, file_size, header.user_labels_offset, header.num_users, mapped.user_labels )
+	 || mapped.offsets[ header.num_places ] != header.num_entries
+	 || !valid_checkins( mapped, header.num_users ) )
+	{
+		std::cerr << "Snapshot file is corrupt: " << filename << std::endl;
+		return 1;
+	}
+
+	mapped.xmin = header.xmin;
+	mapped.xmax = header.xmax;
+	mapped.ymin = header.ymin;
+	mapped.ymax = header.ymax;
+	mapped.max_distance = header.max_distance;
+	mapped.num_checkins = header.num_checkins;
+	mapped.storage = mapping;
+
+	corpus = std::move( mapped );
+	return 0;
+}
+
+} // namespace popular
@@ -0,0 +1,80 @@
+/**
+ * @file
+ * A versioned, memory-mappable binary format for the Corpus.
+ *
+ * Layout (native endianness, every section 64-byte aligned):
+ *  - SnapshotHeader
+ *  - xs            : num_places floats
+ *  - ys            : num_places floats
+ *  - offsets       : num_places + 1 uint32
+ *  - checkin_users : num_entries uint32 (the CSR user ids)
+ *  - user_labels   : num_users uint32
+ */
+
+#ifndef CORPUS_SNAPSHOT
+#define CORPUS_SNAPSHOT
+
+#include <string>
+#include <cstdint>
+
+#include "commons.hpp"
+
+namespace popular
+{
+
+/**
+ * The fixed-size header at the start of a snapshot file.
+ */
+struct SnapshotHeader
+{
+	char magic[ 8 ]; /**< always Constants::SNAPSHOT_MAGIC */
+	uint32_t version; /**< Constants::SNAPSHOT_VERSION at the time of writing */
+	uint32_t header_size; /**< sizeof( SnapshotHeader ), as a sanity check */
+	uint64_t file_size;
+	uint64_t num_places;
+	uint64_t num_users;
+	uint64_t num_entries; /**< the length of the CSR user array */
+	uint32_t num_checkins;
+	float xmin, xmax, ymin, ymax;
+	uint32_t reserved;
+	double max_distance;
+	uint64_t xs_offset; /**< byte offset of each section from the start of the file */
+	uint64_t ys_offset;
+	uint64_t offsets_offset;
+	uint64_t checkin_users_offset;
+	uint64_t user_labels_offset;
+};
+
+/**
+ * Wrapper class for reading and writing corpus snapshots.
+ */
+class CorpusSnapshot {
+
+public:
+	CorpusSnapshot() {} /**< Empty constructor. */
+	~CorpusSnapshot() {} /**< Empty destructor. */
+
+	/**
+	 * @return true if the file exists and starts with the snapshot magic number
+	 */
+	static bool isSnapshot( std::string const& filename );
+
+	/**
+	 * Writes the corpus as a snapshot file.
+	 * @return 0 if successful; 1 if the file could not be written.
+	 */
+	int write( std::string const& filename, Corpus const& corpus ) const;
+
+	/**
+	 * Maps a snapshot file read-only into memory; the corpus views point straight into the
+	 * mapping, so nothing is parsed or copied and the pages are shared between processes.
+	 *
+	 * @return 0 if successful; 1 if the file could not be opened, mapped or is not a valid snapshot.
+	 * @post All contents of corpus are replaced; the mapping lives as long as corpus.storage.
+	 */
+	int map( std::string const& filename, Corpus &corpus ) const;
+};
+
+} // namespace popular
+
+#endif
@@ -0,0 +1,220 @@
+/**
+ * @file
+ * Implementation of the Corpus updater.
+ */
+
+#include "corpusUpdater.hpp"
+
+#include <algorithm> // std::sort(), std::unique(), std::min(), std::max()
+#include <chrono> // for timing
+
+namespace popular
+{
+
+CorpusUpdater::CorpusUpdater( Corpus &corpus )
+	: corpus_( corpus ), storage_( nullptr ), gaps_( 0 ), new_places_( 0 ), new_users_( 0 ), new_checkins_( 0 )
+	, compacted_( false ), seconds_( 0.0 )
+{
+	poi_ids_.reserve( corpus_.num_places() );
+	for( PoiId p = 0; p < corpus_.num_places(); ++p ) { poi_ids_.emplace( corpus_.point( p ), p ); }
+
+	user_ids_.reserve( corpus_.num_users() );
+	for( UserId u = 0; u < corpus_.num_users(); ++u ) { user_ids_.emplace( corpus_.user_labels[ u ], u ); }
+}
+
+void CorpusUpdater::add( uint32_t const user, Point const& point )
+{
+	auto const [ poi, new_poi ] = poi_ids_.emplace( point, static_cast< PoiId >( corpus_.num_places() + places_.size() ) );
+	if( new_poi ) { places_.push_back( point ); }
+
+	auto const [ label, new_user ] = user_ids_.emplace( user, static_cast< UserId >( corpus_.num_users() + labels_.size() ) );
+	if( new_user ) { labels_.push_back( user ); }
+
+	batch_.emplace_back( poi->second, label->second );
+}
+
+namespace // anonymous
+{
+	/**
+	 * The storage of a corpus after an append: the arrays with slack that all the versions
+	 * since the last compaction share, and the offsets of this version.
+	 */
+	struct Appended
+	{
+		std::shared_ptr< CorpusArrays const > arrays;
+		std::vector< uint32_t > offsets;
+		std::vector< uint32_t > ends;
+	};
+
+	template < typename T >
+	void reserve_slack( std::vector< T > &v, size_t const size )
+	{
+		v.reserve( size + static_cast< size_t >( size * Constants::CORPUS_UPDATE_SLACK ) );
+	}
+} // namespace anonymous
+
+/**
+ * Sorts the batch by (POI, user) and appends it if the arrays of the last apply() have room for
+ * the batch and for the users of the POIs it moves; otherwise compacts.
+ */
+void CorpusUpdater::apply()
+{
+	auto const start = std::chrono::high_resolution_clock::now();
+
+	new_checkins_ = batch_.size();
+	new_places_ = places_.size();
+	new_users_ = labels_.size();
+
+	std::sort( batch_.begin(), batch_.end() );
+	batch_.erase( std::unique( batch_.begin(), batch_.end() ), batch_.end() );
+	changed_places_.clear();
+	size_t moved = 0; // the users of the POIs with check-ins that an append moves
+	for( auto const& checkin : batch_ )
+	{
+		if( !changed_places_.empty() && changed_places_.back() == checkin.first ) { continue; }
+		changed_places_.push_back( checkin.first );
+		if( checkin.first < corpus_.num_places() ) { moved += corpus_.checkins( checkin.first ).size(); }
+	}
+
+	for( auto const& point : places_ )
+	{
+		corpus_.xmin = std::min( corpus_.xmin, point.first );
+		corpus_.xmax = std::max( corpus_.xmax, point.first );
+		corpus_.ymin = std::min( corpus_.ymin, point.second );
+		corpus_.ymax = std::max( corpus_.ymax, point.second );
+	}
+
+	compacted_ = !arrays_ || corpus_.storage.get() != storage_
+	          || arrays_->xs.size() + places_.size() > arrays_->xs.capacity()
+	          || arrays_->user_labels.size() + labels_.size() > arrays_->user_labels.capacity()
+	          || arrays_->checkin_users.size() + moved + batch_.size() > arrays_->checkin_users.capacity()
+	          || gaps_ + moved > Constants::CORPUS_UPDATE_SLACK * ( arrays_->checkin_users.size() - gaps_ );
+	if( compacted_ ) { compact(); }
+	else { append(); }
+
+	uint32_t const num_checkins = corpus_.num_checkins + new_checkins_;
+	corpus_.num_checkins = num_checkins;
+	corpus_.max_distance = distance( Point( corpus_.xmin, corpus_.ymin ), Point( corpus_.xmax, corpus_.ymax ) );
+	++corpus_.version;
+
+	places_.clear();
+	labels_.clear();
+	batch_.clear();
+
+	seconds_ = std::chrono::duration< double >( std::chrono::high_resolution_clock::now() - start ).count();
+}
+
+/**
+ * Merges the batch with the sorted users of each POI in one pass over the CSR arrays; POIs
+ * without new check-ins are copied as a whole.
+ */
+void CorpusUpdater::compact()
+{
+	size_t const old_places = corpus_.num_places();
+	size_t const n = old_places + places_.size();
+	auto const arrays = std::make_shared< CorpusArrays >();
+
+	reserve_slack( arrays->xs, n );
+	reserve_slack( arrays->ys, n );
+	arrays->xs.assign( corpus_.xs.cbegin(), corpus_.xs.cend() );
+	arrays->ys.assign( corpus_.ys.cbegin(), corpus_.ys.cend() );
+	for( auto const& point : places_ )
+	{
+		arrays->xs.push_back( point.first );
+		arrays->ys.push_back( point.second );
+	}
+
+	reserve_slack( arrays->user_labels, corpus_.num_users() + labels_.size() );
+	arrays->user_labels.assign( corpus_.user_labels.cbegin(), corpus_.user_labels.cend() );
+	arrays->user_labels.insert( arrays->user_labels.end(), labels_.cbegin(), labels_.cend() );
+
+	arrays->offsets.resize( n + 1 );
+	reserve_slack( arrays->checkin_users, corpus_.num_entries() + batch_.size() );
+	auto next = batch_.cbegin();
+	for( PoiId p = 0; p < n; ++p )
+	{
+		arrays->offsets[ p ] = arrays->checkin_users.size();
+		UserList const old = p < old_places ? corpus_.checkins( p ) : UserList();
+		auto it = old.cbegin();
+
+		for( ; next != batch_.cend() && next->first == p; ++next )
+		{
+			UserId const user = next->second;
+			for( ; it != old.cend() && *it < user; ++it ) { arrays->checkin_users.push_back( *it ); }
+			if( it != old.cend() && *it == user ) { ++it; }
+			arrays->checkin_users.push_back( user );
+		}
+		arrays->checkin_users.insert( arrays->checkin_users.end(), it, old.cend() );
+	}
+	arrays->offsets[ n ] = arrays->checkin_users.size();
+
+	corpus_.xs = arrays->xs;
+	corpus_.ys = arrays->ys;
+	corpus_.offsets = arrays->offsets;
+	corpus_.checkin_users = arrays->checkin_users;
+	corpus_.user_labels = arrays->user_labels;
+	corpus_.ends = ArrayView< uint32_t >();
+	corpus_.storage = arrays;
+	arrays_ = arrays;
+	storage_ = arrays.get();
+	gaps_ = 0;
+}
+
+/**
+ * The capacity was checked, so the arrays do not move while the users of a POI are read from
+ * and appended to checkin_users.
+ */
+void CorpusUpdater::append()
+{
+	size_t const old_places = corpus_.num_places();
+	size_t const n = old_places + places_.size();
+	auto const appended = std::make_shared< Appended >();
+	appended->arrays = arrays_;
+
+	appended->offsets.reserve( n + 1 );
+	appended->offsets.assign( corpus_.offsets.cbegin(), corpus_.offsets.cbegin() + old_places );
+	appended->ends.reserve( n );
+	if( corpus_.ends.empty() ) { appended->ends.assign( corpus_.offsets.cbegin() + 1, corpus_.offsets.cend() ); }
+	else { appended->ends.assign( corpus_.ends.cbegin(), corpus_.ends.cend() ); }
+	appended->offsets.resize( n );
+	appended->ends.resize( n );
+
+	for( auto const& point : places_ )
+	{
+		arrays_->xs.push_back( point.first );
+		arrays_->ys.push_back( point.second );
+	}
+	arrays_->user_labels.insert( arrays_->user_labels.end(), labels_.cbegin(), labels_.cend() );
+
+	std::vector< UserId > &users = arrays_->checkin_users;
+	for( auto next = batch_.cbegin(); next != batch_.cend(); )
+	{
+		PoiId const p = next->first;
+		UserList const old = p < old_places ? corpus_.checkins( p ) : UserList();
+		auto it = old.cbegin();
+		gaps_ += old.size();
+		appended->offsets[ p ] = users.size();
+
+		for( ; next != batch_.cend() && next->first == p; ++next )
+		{
+			UserId const user = next->second;
+			for( ; it != old.cend() && *it < user; ++it ) { users.push_back( *it ); }
+			if( it != old.cend() && *it == user ) { ++it; }
+			users.push_back( user );
+		}
+		for( ; it != old.cend(); ++it ) { users.push_back( *it ); } // not insert(), as old lies in users
+		appended->ends[ p ] = users.size();
+	}
+	appended->offsets.push_back( users.size() );
+
+	corpus_.xs = arrays_->xs;
+	corpus_.ys = arrays_->ys;
+	corpus_.checkin_users = users;
+	corpus_.user_labels = arrays_->user_labels;
+	corpus_.offsets = appended->offsets;
+	corpus_.ends = appended->ends;
+	corpus_.storage = appended;
+	storage_ = appended.get();
+}
+
+} // namespace popular
@@ -0,0 +1,108 @@
+/**
+ * @file
+ * Incremental ingestion of check-in batches into an already loaded Corpus.
+ */
+
+#ifndef CORPUS_UPDATER
+#define CORPUS_UPDATER
+
+#include <vector>
+#include <memory> // std::shared_ptr
+#include <unordered_map>
+
+#include "commons.hpp"
+
+namespace popular
+{
+
+/**
+ * Appends batches of raw check-ins to a loaded corpus without re-interning it.
+ * Existing POI and user ids are kept; new POIs and new users get the next free ids,
+ * so after an update the dense user ids no longer follow the order of the input ids.
+ */
+class CorpusUpdater {
+
+public:
+	/**
+	 * Indexes the points and user ids of the corpus, which must outlive the updater.
+	 */
+	explicit CorpusUpdater( Corpus &corpus );
+	~CorpusUpdater() {} /**< Empty destructor. */
+
+	/**
+	 * Records one check-in of the next batch.
+	 * @param user : the user id as it appears in the input
+	 * @param point : the location of the POI
+	 */
+	void add( uint32_t const user, Point const& point );
+
+	/**
+	 * Reserves space for the given number of check-ins.
+	 */
+	void reserve( size_t const num_checkins ) { batch_.reserve( num_checkins ); }
+
+	size_t pending() const { return batch_.size(); } /**< check-ins recorded since the last apply() */
+
+	/**
+	 * Merges the recorded check-ins into the corpus, keeping every POI's users sorted and
+	 * unique, and updates the bounding box, max_distance and num_checkins.
+	 *
+	 * The arrays the updater owns have slack: the new POIs and users are appended to them,
+	 * and the merged users of each POI that got check-ins are appended to checkin_users,
+	 * leaving a gap where they were (see Corpus::ends). Only the offsets are copied, so a
+	 * batch costs time in its size and the number of POIs, not in the check-ins of the
+	 * corpus. Once the slack runs out or the gaps outgrow Constants::CORPUS_UPDATE_SLACK of
+	 * the check-ins, the corpus is merged into new compact arrays with slack instead, as on
+	 * the first apply(); a memory-mapped corpus is copied into owned storage that way.
+	 * Appending never moves nor overwrites what earlier versions of the corpus see, so
+	 * they stay valid.
+	 *
+	 * @post The corpus views point to new arrays and corpus.version is incremented,
+	 * so derived structures (e.g. the R-tree user aggregates) can tell that they are stale;
+	 * the updater is emptied.
+	 */
+	void apply();
+
+	size_t new_places() const { return new_places_; } /**< POIs added by the last apply() */
+	size_t new_users() const { return new_users_; } /**< users added by the last apply() */
+	size_t new_checkins() const { return new_checkins_; } /**< check-ins merged by the last apply() */
+	bool compacted() const { return compacted_; } /**< whether the last apply() merged the corpus into new arrays */
+	/**
+	 * @return the POIs that got check-ins from the last apply(), the new ones (ids from
+	 * num_places() - new_places()) included, in id order; see Index::insert() and Index::addCheckins()
+	 */
+	std::vector< PoiId > const& changed_places() const { return changed_places_; }
+	double seconds() const { return seconds_; } /**< Wall time of the last apply() */
+
+private:
+	/**
+	 * Merges the batch into new compact arrays with slack.
+	 */
+	void compact();
+
+	/**
+	 * Appends the batch to the arrays of the last apply().
+	 */
+	void append();
+
+	Corpus &corpus_;
+	std::shared_ptr< CorpusArrays > arrays_; /**< the arrays with slack that the corpus views, if the last apply() made them */
+	void const* storage_; /**< the storage the last apply() gave the corpus, to tell whether arrays_ still backs it */
+	size_t gaps_; /**< the entries of checkin_users that no POI uses any more */
+	std::unordered_map< Point, PoiId, boost::hash< Point > > poi_ids_; /**< the dense id of each point */
+	std::unordered_map< uint32_t, UserId > user_ids_; /**< the dense id of each input user id */
+	std::vector< Point > places_; /**< the points of the POIs added by the batch */
+	std::vector< uint32_t > labels_; /**< the input ids of the users added by the batch */
+	std::vector< std::pair< PoiId, UserId > > batch_; /**< (POI id, user id) per recorded check-in */
+	std::vector< PoiId > changed_places_;
+
+	size_t new_places_;
+	size_t new_users_;
+	size_t new_checkins_;
+	bool compacted_;
+	double seconds_;
+};
+
+} // namespace popular
+
+#endif
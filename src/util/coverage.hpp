@@ -0,0 +1,107 @@
+/**
+ * @file
+ * A dense bitset of the users covered by the POIs chosen so far.
+ */
+
+#ifndef POPULAR_COVERAGE
+#define POPULAR_COVERAGE
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace popular
+{
+    /**
+     * Keeps the covered users as one bit per dense user id, so that the marginal gain of a
+     * candidate is a probe of each of its users instead of a merge with the whole coverage.
+     */
+    class Coverage
+    {
+    public:
+        Coverage() : count_( 0 ) {}
+
+        /**
+         * @param num_users : the size of the user id universe
+         */
+        explicit Coverage( size_t const num_users ) : words_( ( num_users + 63 ) / 64, 0u ), count_( 0 ) {}
+
+        size_t size() const { return count_; } /**< the number of covered users */
+        bool empty() const { return count_ == 0; }
+        size_t bytes() const { return words_.capacity() * sizeof( uint64_t ); }
+
+        bool contains( uint32_t const user ) const
+        {
+            return ( words_[ user >> 6 ] >> ( user & 63 ) ) & 1u;
+        }
+
+        /**
+         * Counts the users of a sorted range (or any iterable of user ids) that are not covered yet
+         */
+        template < typename R >
+        size_t uncovered( R const& users ) const
+        {
+            size_t count = 0u;
+            for( uint32_t const user : users ) { count += !contains( user ); }
+            return count;
+        }
+
+        /**
+         * @return true if all users of the range are covered; stops at the first uncovered one
+         */
+        template < typename R >
+        bool covers( R const& users ) const
+        {
+            for( uint32_t const user : users ) { if( !contains( user ) ) { return false; } }
+            return true;
+        }
+
+        /**
+         * Marks all users of the range as covered
+         */
+        template < typename R >
+        void add( R const& users )
+        {
+            for( uint32_t const user : users )
+            {
+                uint64_t const bit = uint64_t( 1 ) << ( user & 63 );
+                count_ += !( words_[ user >> 6 ] & bit );
+                words_[ user >> 6 ] |= bit;
+            }
+        }
+
+        /**
+         * Marks the set bits of word w, i.e. of users [64 w, 64 w + 64), as covered
+         */
+        void add_word( size_t const w, uint64_t const bits )
+        {
+            count_ += __builtin_popcountll( bits & ~words_[ w ] );
+            words_[ w ] |= bits;
+        }
+
+        /**
+         * Calls f on every covered user, in increasing order
+         */
+        template < typename F >
+        void for_each( F f ) const
+        {
+            for( size_t w = 0; w < words_.size(); ++w )
+            {
+                for( uint64_t bits = words_[ w ]; bits != 0; bits &= bits - 1 )
+                {
+                    f( static_cast< uint32_t >( w * 64 + __builtin_ctzll( bits ) ) );
+                }
+            }
+        }
+
+        uint64_t const* words() const { return words_.data(); } /**< the raw bitset, for word-wise kernels */
+        size_t num_words() const { return words_.size(); }
+
+    private:
+        std::vector< uint64_t > words_;
+        size_t count_;
+    };
+
+} // namespace popular
+
+#endif
@@ -0,0 +1,271 @@
+/**
+ * @file
+ * Implementation of the container selection and the coverage operations of HybridSet.
+ */
+
+#include "hybridSet.hpp"
+
+#include <algorithm> // std::lower_bound(), std::binary_search(), std::min()
+
+namespace popular
+{
+    namespace // anonymous
+    {
+        /**
+         * Calls f( w, mask ) for every word w overlapping the bit range [lo, hi), with the mask
+         * of the bits of w inside the range
+         */
+        template < typename F >
+        void for_each_word( size_t const lo, size_t const hi, F f )
+        {
+            size_t const first = lo >> 6, last = ( hi - 1 ) >> 6;
+            uint64_t const first_mask = ~uint64_t( 0 ) << ( lo & 63 );
+            uint64_t const last_mask = ~uint64_t( 0 ) >> ( 63 - ( ( hi - 1 ) & 63 ) );
+            if( first == last ) { f( first, first_mask & last_mask ); return; }
+            f( first, first_mask );
+            for( size_t w = first + 1; w < last; ++w ) { f( w, ~uint64_t( 0 ) ); }
+            f( last, last_mask );
+        }
+
+        size_t popcount_range( uint64_t const* words, size_t const lo, size_t const hi )
+        {
+            size_t count = 0u;
+            for_each_word( lo, hi, [&]( size_t const w, uint64_t const mask ) { count += __builtin_popcountll( words[ w ] & mask ); } );
+            return count;
+        }
+
+        bool test_bit( uint64_t const* words, uint32_t const bit )
+        {
+            return ( words[ bit >> 6 ] >> ( bit & 63 ) ) & 1u;
+        }
+
+        /**
+         * Runs are stored as (start, length - 1) pairs
+         */
+        size_t array_run( uint16_t const* a, size_t const na, uint16_t const* runs, size_t const nr )
+        {
+            size_t i = 0, r = 0, count = 0;
+            while( i < na && r < nr )
+            {
+                uint32_t const start = runs[ 2 * r ];
+                uint32_t const end = start + runs[ 2 * r + 1 ];
+                if( a[ i ] < start ) { ++i; }
+                else if( a[ i ] > end ) { ++r; }
+                else { ++count; ++i; }
+            }
+            return count;
+        }
+    } // namespace anonymous
+
+    HybridSet::HybridSet( value_type const* first, value_type const* last ) : size_( last - first )
+    {
+        for( value_type const* chunk = first; chunk < last; )
+        {
+            uint16_t const key = static_cast< uint16_t >( *chunk >> 16 );
+            value_type const* chunk_end = chunk;
+            size_t num_runs = 0u;
+            for( ; chunk_end < last && ( *chunk_end >> 16 ) == key; ++chunk_end )
+            {
+                num_runs += chunk_end == chunk || *chunk_end != *( chunk_end - 1 ) + 1;
+            }
+
+            size_t const n = chunk_end - chunk;
+            size_t const array_bytes = n * sizeof( uint16_t );
+            size_t const run_bytes = num_runs * 2 * sizeof( uint16_t );
+            size_t const bitmap_bytes = BITMAP_WORDS * sizeof( uint64_t );
+
+            Container container{ key, Kind::Array, static_cast< uint32_t >( n ), static_cast< uint32_t >( shorts_.size() ), static_cast< uint32_t >( n ) };
+            if( run_bytes < array_bytes && run_bytes <= bitmap_bytes )
+            {
+                container.kind = Kind::Run;
+                container.length = static_cast< uint32_t >( num_runs );
+                for( value_type const* v = chunk; v < chunk_end; )
+                {
+                    value_type const* run_end = v + 1;
+                    while( run_end < chunk_end && *run_end == *( run_end - 1 ) + 1 ) { ++run_end; }
+                    shorts_.push_back( static_cast< uint16_t >( *v ) );
+                    shorts_.push_back( static_cast< uint16_t >( run_end - v - 1 ) );
+                    v = run_end;
+                }
+            }
+            else if( bitmap_bytes < array_bytes )
+            {
+                container.kind = Kind::Bitmap;
+                container.offset = static_cast< uint32_t >( words_.size() );
+                container.length = BITMAP_WORDS;
+                words_.resize( words_.size() + BITMAP_WORDS, 0u );
+                uint64_t* bits = words_.data() + container.offset;
+                for( value_type const* v = chunk; v < chunk_end; ++v ) { bits[ ( *v & 0xffff ) >> 6 ] |= uint64_t( 1 ) << ( *v & 63 ); }
+            }
+            else
+            {
+                for( value_type const* v = chunk; v < chunk_end; ++v ) { shorts_.push_back( static_cast< uint16_t >( *v ) ); }
+            }
+            containers_.push_back( container );
+            chunk = chunk_end;
+        }
+        containers_.shrink_to_fit();
+        shorts_.shrink_to_fit();
+        words_.shrink_to_fit();
+    }
+
+    bool HybridSet::contains( value_type const value ) const
+    {
+        uint16_t const key = static_cast< uint16_t >( value >> 16 );
+        uint16_t const low = static_cast< uint16_t >( value );
+        auto const c = std::lower_bound( containers_.begin(), containers_.end(), key
+                                       , []( Container const& container, uint16_t const k ) { return container.key < k; } );
+        if( c == containers_.end() || c->key != key ) { return false; }
+
+        switch( c->kind )
+        {
+        case Kind::Array:
+            return std::binary_search( shorts( *c ), shorts( *c ) + c->length, low );
+        case Kind::Bitmap:
+            return test_bit( words( *c ), low );
+        case Kind::Run:
+            return array_run( &low, 1, shorts( *c ), c->length ) == 1;
+        }
+        return false;
+    }
+
+    size_t HybridSet::count_not_in( Coverage const& coverage ) const
+    {
+        uint64_t const* covered = coverage.words();
+        size_t count = 0u;
+        for( Container const& c : containers_ )
+        {
+            size_t const base = size_t( c.key ) << 16;
+            switch( c.kind )
+            {
+            case Kind::Array:
+                for( size_t i = 0; i < c.length; ++i ) { count += !test_bit( covered, base | shorts( c )[ i ] ); }
+                break;
+            case Kind::Bitmap:
+            {
+                // the bitmap holds no ids past the user universe, so the words past it are zero
+                size_t const first_word = base >> 6;
+                size_t const n = std::min( size_t( BITMAP_WORDS ), coverage.num_words() - first_word );
+                for( size_t w = 0; w < n; ++w ) { count += __builtin_popcountll( words( c )[ w ] & ~covered[ first_word + w ] ); }
+                break;
+            }
+            case Kind::Run:
+                for( size_t r = 0; r < c.length; ++r )
+                {
+                    size_t const start = base | shorts( c )[ 2 * r ];
+                    size_t const length = shorts( c )[ 2 * r + 1 ] + 1u;
+                    count += length - popcount_range( covered, start, start + length );
+                }
+                break;
+            }
+        }
+        return count;
+    }
+
+    bool HybridSet::subset_of( Coverage const& coverage ) const
+    {
+        uint64_t const* covered = coverage.words();
+        for( Container const& c : containers_ )
+        {
+            size_t const base = size_t( c.key ) << 16;
+            switch( c.kind )
+            {
+            case Kind::Array:
+                for( size_t i = 0; i < c.length; ++i ) { if( !test_bit( covered, base | shorts( c )[ i ] ) ) { return false; } }
+                break;
+            case Kind::Bitmap:
+            {
+                size_t const first_word = base >> 6;
+                size_t const n = std::min( size_t( BITMAP_WORDS ), coverage.num_words() - first_word );
+                for( size_t w = 0; w < n; ++w ) { if( words( c )[ w ] & ~covered[ first_word + w ] ) { return false; } }
+                break;
+            }
+            case Kind::Run:
+                for( size_t r = 0; r < c.length; ++r )
+                {
+                    size_t const start = base | shorts( c )[ 2 * r ];
+                    size_t const length = shorts( c )[ 2 * r + 1 ] + 1u;
+                    if( popcount_range( covered, start, start + length ) != length ) { return false; }
+                }
+                break;
+            }
+        }
+        return true;
+    }
+
+    void HybridSet::add_to( Coverage &coverage ) const
+    {
+        for( Container const& c : containers_ )
+        {
+            size_t const base = size_t( c.key ) << 16;
+            switch( c.kind )
+            {
+            case Kind::Array:
+                for( size_t i = 0; i < c.length; ++i )
+                {
+                    size_t const user = base | shorts( c )[ i ];
+                    coverage.add_word( user >> 6, uint64_t( 1 ) << ( user & 63 ) );
+                }
+                break;
+            case Kind::Bitmap:
+            {
+                size_t const first_word = base >> 6;
+                size_t const n = std::min( size_t( BITMAP_WORDS ), coverage.num_words() - first_word );
+                for( size_t w = 0; w < n; ++w ) { coverage.add_word( first_word + w, words( c )[ w ] ); }
+                break;
+            }
+            case Kind::Run:
+                for( size_t r = 0; r < c.length; ++r )
+                {
+                    size_t const start = base | shorts( c )[ 2 * r ];
+                    for_each_word( start, start + shorts( c )[ 2 * r + 1 ] + 1
+                                 , [&]( size_t const w, uint64_t const mask ) { coverage.add_word( w, mask ); } );
+                }
+                break;
+            }
+        }
+    }
+
+    std::vector< HybridSet::value_type > HybridSet::decode() const
+    {
+        std::vector< value_type > result;
+        result.reserve( size_ );
+        for( Container const& c : containers_ )
+        {
+            value_type const base = value_type( c.key ) << 16;
+            switch( c.kind )
+            {
+            case Kind::Array:
+                for( size_t i = 0; i < c.length; ++i ) { result.push_back( base | shorts( c )[ i ] ); }
+                break;
+            case Kind::Bitmap:
+                for( size_t w = 0; w < BITMAP_WORDS; ++w )
+                {
+                    for( uint64_t bits = words( c )[ w ]; bits != 0; bits &= bits - 1 )
+                    {
+                        result.push_back( base | static_cast< value_type >( w * 64 + __builtin_ctzll( bits ) ) );
+                    }
+                }
+                break;
+            case Kind::Run:
+                for( size_t r = 0; r < c.length; ++r )
+                {
+                    value_type const start = base | shorts( c )[ 2 * r ];
+                    for( value_type v = 0; v <= shorts( c )[ 2 * r + 1 ]; ++v ) { result.push_back( start + v ); }
+                }
+                break;
+            }
+        }
+        return result;
+    }
+
+    size_t HybridSet::count_kind( Kind const kind ) const
+    {
+        return std::count_if( containers_.begin(), containers_.end(), [kind]( Container const& c ) { return c.kind == kind; } );
+    }
+
+    size_t HybridSet::num_arrays() const { return count_kind( Kind::Array ); }
+    size_t HybridSet::num_bitmaps() const { return count_kind( Kind::Bitmap ); }
+    size_t HybridSet::num_runs() const { return count_kind( Kind::Run ); }
+
+} // namespace popular
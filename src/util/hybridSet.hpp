@@ -0,0 +1,118 @@
+/**
+ * @file
+ * A Roaring-style set of user ids that picks an array, bitmap or run container per 64K-id chunk.
+ */
+
+#ifndef POPULAR_HYBRID_SET
+#define POPULAR_HYBRID_SET
+
+#include <vector>
+#include <algorithm> // std::count_if()
+#include <cstdint>
+#include <cstddef>
+
+#include "coverage.hpp"
+
+namespace popular
+{
+    /**
+     * Splits the ids by their upper 16 bits into chunks and stores each chunk in whichever
+     * container is smallest for its density:
+     *  - Array  : the sorted lower 16 bits, 2 bytes per id (sparse chunks);
+     *  - Bitmap : 2^16 bits, 8 KB per chunk (dense chunks);
+     *  - Run    : (start, length - 1) pairs, 4 bytes per run (clustered or near-complete chunks).
+     * The coverage operations work chunk by chunk on the native containers, without decoding to ids.
+     */
+    class HybridSet
+    {
+    public:
+        using value_type = uint32_t;
+
+        HybridSet() : size_( 0 ) {}
+
+        /**
+         * Builds the set from the sorted, unique values in [first, last).
+         */
+        HybridSet( value_type const* first, value_type const* last );
+
+        template < typename R >
+        explicit HybridSet( R const& sorted ) : HybridSet( sorted.data(), sorted.data() + sorted.size() ) {}
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        /**
+         * @return the heap bytes used by the set
+         */
+        size_t bytes() const
+        {
+            return containers_.capacity() * sizeof( Container ) + shorts_.capacity() * sizeof( uint16_t )
+                 + words_.capacity() * sizeof( uint64_t );
+        }
+
+        bool contains( value_type const value ) const;
+
+        /**
+         * Counts the values of the sorted range other that are also in the set
+         */
+        template < typename R >
+        size_t intersection_size( R const& other ) const
+        {
+            return std::count_if( other.begin(), other.end(), [ this ]( value_type const v ){ return contains( v ); } );
+        }
+
+        /**
+         * Counts the values that are not covered yet; bitmap chunks are compared a word at a time
+         */
+        size_t count_not_in( Coverage const& coverage ) const;
+
+        /**
+         * @return true if all values are covered; stops at the first chunk with an uncovered one
+         */
+        bool subset_of( Coverage const& coverage ) const;
+
+        /**
+         * Marks all values as covered
+         */
+        void add_to( Coverage &coverage ) const;
+
+        /**
+         * Decodes the whole set in increasing order.
+         */
+        std::vector< value_type > decode() const;
+
+        /**
+         * @return the number of chunks stored as array, bitmap and run containers
+         */
+        size_t num_arrays() const;
+        size_t num_bitmaps() const;
+        size_t num_runs() const;
+
+    private:
+        enum class Kind : uint8_t { Array, Bitmap, Run };
+
+        struct Container
+        {
+            uint16_t key; /**< the upper 16 bits shared by the chunk */
+            Kind kind;
+            uint32_t cardinality;
+            uint32_t offset; /**< into shorts_ (Array, Run) or words_ (Bitmap) */
+            uint32_t length; /**< number of uint16 values (Array), uint16 pairs (Run) or words (Bitmap) */
+        };
+
+        static size_t const BITMAP_WORDS = 1024; /**< 2^16 bits */
+
+        size_t count_kind( Kind const kind ) const;
+
+        uint16_t const* shorts( Container const& c ) const { return shorts_.data() + c.offset; }
+        uint64_t const* words( Container const& c ) const { return words_.data() + c.offset; }
+
+        std::vector< Container > containers_; /**< sorted by key */
+        std::vector< uint16_t > shorts_; /**< pool of array and run container payloads */
+        std::vector< uint64_t > words_; /**< pool of bitmap container payloads */
+        size_t size_;
+    };
+
+} // namespace popular
+
+#endif
@@ -4,78 +4,168 @@
  */
 
 #include "inputReader.hpp"
+#include "corpusBuilder.hpp"
+#include "corpusUpdater.hpp"
+#include "corpusSnapshot.hpp"
 
 #include <iostream>
 #include <string>
 #include <fstream>
-#include <sstream>
 #include <vector>
-#include <algorithm> // std::for_each()
+#include <chrono> // for timing
+#include <charconv> // std::from_chars()
+#include <omp.h> // omp_get_max_threads()
 
 
 namespace popular
 {
 
+namespace // anonymous
+{
+    struct RawCheckin
+    {
+        uint32_t user;
+        Point point;
+    };
+
+    /**
+     * Parses one field with std::from_chars, skipping leading blanks.
+     * @return : a pointer past the parsed field, or nullptr if the field is malformed
+     */
+    template < typename T >
+    char const* parse_field( char const* first, char const* last, T &value )
+    {
+        while( first != last && ( *first == ' ' || *first == '\t' ) ) { ++first; }
+        auto const [ ptr, ec ] = std::from_chars( first, last, value );
+        return ec == std::errc() ? ptr : nullptr;
+    }
+
+    /**
+     * Parses the lines in [first, last) into the buffer; the range must start at the beginning of a line.
+     * @return : the number of non-empty lines that could not be parsed
+     */
+    size_t parse_chunk( char const* first, char const* last, std::vector< RawCheckin > &buffer )
+    {
+        size_t malformed = 0;
+        while( first < last )
+        {
+            char const* eol = std::find( first, last, '\n' );
+            RawCheckin checkin;
+            char const* p = parse_field( first, eol, checkin.user );
+            if( p ) { p = parse_field( p, eol, checkin.point.first ); }
+            if( p ) { p = parse_field( p, eol, checkin.point.second ); }
+
+            if( p ) { buffer.push_back( checkin ); }
+            else if( eol != first && !( eol - first == 1 && *first == '\r' ) ) { ++malformed; }
+
+            first = eol + 1;
+        }
+        return malformed;
+    }
+
+    /**
+     * Reads the whole file into memory, splits it into line-aligned chunks and
+     * parses the chunks in parallel into per-chunk buffers, in file order.
+     * @return : 0 if successful; 1 if the file could not be opened for reading
+     */
+    int parse_file( std::string const& filename, std::vector< std::vector< RawCheckin > > &buffers, size_t &bytes_read )
+    {
+        std::ifstream infile( filename, std::ios::binary | std::ios::ate );
+        if( !infile )
+        {
+            std::cerr << "Could not open input file for reading: " << filename << std::endl;
+            return 1;
+        }
+        std::string data( static_cast< size_t >( infile.tellg() ), '\0' );
+        infile.seekg( 0 );
+        infile.read( &data[0], data.size() );
+
+        size_t const num_chunks = 4 * omp_get_max_threads();
+        std::vector< size_t > bounds( num_chunks + 1, data.size() );
+        bounds[ 0 ] = 0;
+        for( size_t c = 1; c < num_chunks; ++c )
+        {
+            size_t const guess = std::max( bounds[ c - 1 ], data.size() * c / num_chunks );
+            size_t const eol = data.find( '\n', guess );
+            bounds[ c ] = eol == std::string::npos ? data.size() : eol + 1;
+        }
+
+        buffers.assign( num_chunks, std::vector< RawCheckin >() );
+        size_t malformed = 0;
+        #pragma omp parallel for schedule(dynamic, 1) reduction(+:malformed)
+        for( size_t c = 0; c < num_chunks; ++c )
+        {
+            buffers[ c ].reserve( ( bounds[ c + 1 ] - bounds[ c ] ) / 24 );
+            malformed += parse_chunk( data.data() + bounds[ c ], data.data() + bounds[ c + 1 ], buffers[ c ] );
+        }
+
+        if( malformed > 0 )
+        {
+            std::cerr << "Skipped " << malformed << " malformed line(s) in " << filename << std::endl;
+        }
+        bytes_read = data.size();
+        return 0;
+    }
+} // namespace anonymous
+
 /**
- * Assumes tab-separated file.
- * Iterates each line of the input, splits it on the tab character to produce
- * a userID a longitude and a latitude.
+ * Snapshot files are memory-mapped; anything else is assumed to be a tab-separated file.
+ * The buffers parsed in parallel are merged in file order, so the resulting ids do not
+ * depend on the number of threads.
  */
 int InputReader::readFile( std::string &filename, Corpus &corpus ) {
-	
-	std::ifstream infile( filename );
-	if( infile ) { // check that file opened correctly.
-        std::string line;
-        while (std::getline(infile, line))
-        {
-            std::stringstream ss;
-            ss.str(line);
-            std::string item;
-            if (std::getline(ss, item, '\t'))
-            {
-                UserId user = stoi(item);
-                corpus.users.insert(user);
-                Point point;
-                if (std::getline(ss, item, '\t'))
-                {
-                    point.first = std::stof(item);
-                    if (std::getline(ss, item, '\t'))
-                    {
-                        point.second = std::stof(item);
-                        corpus.places.insert(point);
-                        std::vector< UserId > a = corpus.checkins[point];
-                        a.push_back(user);
-                        corpus.checkins[point] = a;
-
-                        corpus.xmin = std::min( corpus.xmin, point.first );
-                        corpus.xmax = std::max( corpus.xmax, point.first );
-                        corpus.ymin = std::min( corpus.ymin, point.second );
-                        corpus.ymax = std::max( corpus.ymax, point.second );
-
-                        corpus.num_checkins++;
-                    }
-                }
-            }
-        }
 
-        std::for_each(corpus.checkins.begin(), corpus.checkins.end(),
-                [](auto &checkin)
-                {
-                    std::sort(checkin.second.begin(), checkin.second.end());
-                    auto it = std::unique(checkin.second.begin(), checkin.second.end());
-                    checkin.second.resize(std::distance(checkin.second.begin(),it));
-                });
-
-        Point pmin = std::make_pair(corpus.xmin, corpus.ymin);
-        Point pmax = std::make_pair(corpus.xmax, corpus.ymax);
-        corpus.max_distance = distance(pmin, pmax);
+	auto const start = std::chrono::high_resolution_clock::now();
+
+	if( CorpusSnapshot::isSnapshot( filename ) )
+	{
+		if( CorpusSnapshot().map( filename, corpus ) == 1 ) { return 1; }
+
+		// nothing is read up front: the pages of the mapping are faulted in on demand
+		bytes_read_ = std::ifstream( filename, std::ios::binary | std::ios::ate ).tellg();
+		seconds_ = std::chrono::duration< double >( std::chrono::high_resolution_clock::now() - start ).count();
+		return 0;
 	}
-	else {
-		std::cerr << "Could not open input file for reading: " << filename << std::endl;
-		return 1;
+
+	std::vector< std::vector< RawCheckin > > buffers;
+	if( parse_file( filename, buffers, bytes_read_ ) == 1 ) { return 1; }
+
+	size_t total = 0;
+	for( auto const& buffer : buffers ) { total += buffer.size(); }
+
+	CorpusBuilder builder;
+	builder.reserve( total );
+	for( auto &buffer : buffers )
+	{
+		for( auto const& checkin : buffer ) { builder.add( checkin.user, checkin.point ); }
+		std::vector< RawCheckin >().swap( buffer );
 	}
-	
+	builder.build(corpus);
+
+	seconds_ = std::chrono::duration< double >( std::chrono::high_resolution_clock::now() - start ).count();
+
 	return 0; // Success!
 }
 
+int InputReader::appendFile( std::string &filename, CorpusUpdater &updater ) {
+
+	auto const start = std::chrono::high_resolution_clock::now();
+
+	std::vector< std::vector< RawCheckin > > buffers;
+	if( parse_file( filename, buffers, bytes_read_ ) == 1 ) { return 1; }
+
+	size_t total = updater.pending();
+	for( auto const& buffer : buffers ) { total += buffer.size(); }
+
+	updater.reserve( total );
+	for( auto &buffer : buffers )
+	{
+		for( auto const& checkin : buffer ) { updater.add( checkin.user, checkin.point ); }
+		std::vector< RawCheckin >().swap( buffer );
+	}
+
+	seconds_ = std::chrono::duration< double >( std::chrono::high_resolution_clock::now() - start ).count();
+	return 0;
+}
+
 } // namespace popular
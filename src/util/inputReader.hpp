@@ -13,25 +13,53 @@
 namespace popular
 {
 
+class CorpusUpdater;
+
 /**
  * Wrapper class for our file parsing methods.
  */
 class InputReader {
 
 public:
-	InputReader() {} /**< Empty constructor. */
+	InputReader() : bytes_read_( 0 ), seconds_( 0.0 ) {} /**< Empty constructor. */
 	~InputReader() {} /**< Empty destructor. */
 	
 	/**
-	 * Reads a tab-separated file into a new corpus object.
+	 * Reads a tab-separated file or a corpus snapshot into a new corpus object.
+	 * A tab-separated file is parsed in parallel by all OpenMP threads; lines that cannot be parsed are skipped.
+	 * A snapshot (detected by its magic number) is memory-mapped instead of parsed.
 	 *
 	 * @param filename The file path for in the input file (as a string)
 	 * @param corpus The object into which the input file should be loaded.
-	 * @return 0 if successful; 1 if the input file could not be opened for reading.
+	 * @return 0 if successful; 1 if the input file could not be opened for reading or is an invalid snapshot.
 	 * @post All contents of corpus are erased and replaced with the data in the input file.
 	 */
 	int readFile( std::string &filename, Corpus &corpus );
 
+	/**
+	 * Reads a tab-separated file of check-ins into the updater, without applying them.
+	 *
+	 * @param filename The file path for in the input file (as a string)
+	 * @param updater The updater of the corpus that the check-ins are appended to.
+	 * @return 0 if successful; 1 if the input file could not be opened for reading.
+	 */
+	int appendFile( std::string &filename, CorpusUpdater &updater );
+
+	size_t bytes_read() const { return bytes_read_; } /**< Size of the last file read */
+	double seconds() const { return seconds_; } /**< Wall time of the last readFile(), including interning */
+
+	/**
+	 * @return the load throughput of the last readFile() in MB/s
+	 */
+	double megabytes_per_second() const
+	{
+		return seconds_ > 0.0 ? bytes_read_ / ( 1024.0 * 1024.0 ) / seconds_ : 0.0;
+	}
+
+private:
+	size_t bytes_read_;
+	double seconds_;
+
 };
 
 } // namespace popular
@@ -32,7 +32,7 @@ namespace popular
 
     class PriorityQueue
     {
-        using PQEntry = std::pair< Point, double >;
+        using PQEntry = std::pair< PoiId, double >;
         using Q = std::priority_queue< PQEntry, std::vector< PQEntry >, entryIsGreater >;
         using Ql = std::priority_queue< PQEntry, std::vector< PQEntry >, entryIsLess >;
 
@@ -44,14 +44,15 @@ namespace popular
         ~PriorityQueue() {} /**< Empty destructor */
         PriorityQueue(size_t const size)
         {
-            std::vector< PQEntry > init_vals (size, {std::make_pair(FLT_MAX, FLT_MAX), -DBL_MAX});
+            PoiId const no_poi = std::numeric_limits< PoiId >::max();
+            std::vector< PQEntry > init_vals (size, {no_poi, -DBL_MAX});
             q = Q(init_vals.begin(), init_vals.end());
 
-            init_vals = std::vector< PQEntry >(size, {std::make_pair(FLT_MAX, FLT_MAX), DBL_MAX});
+            init_vals = std::vector< PQEntry >(size, {no_poi, DBL_MAX});
             ql = Ql(init_vals.begin(), init_vals.end());
         }
 
-        void add_to_queue(Point const& point, double score)
+        void add_to_queue(PoiId const point, double score)
         {
             if (score > q.top().second)
             {
@@ -60,7 +61,7 @@ namespace popular
             }
         }
 
-        Point return_best()
+        PoiId return_best()
         {
             PQEntry entry = ql.top();
             ql.pop();